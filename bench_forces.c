@@ -0,0 +1,150 @@
+//
+// bench_forces: compares pairs per second of the naive and the tiled
+// force shaders. Run under software GL to get numbers that don't depend
+// on the GPU at hand:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 ./bench_forces
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include "raylib.h"
+#include "rlgl.h"
+
+#include "rs_particles.h"
+
+#define MAX_PARTICLES                (16384)
+#define NUM_FIXED_PARTICLES            (512)
+#define FORCES_TILE_SIZE               (256)
+#define WARMUP_RUNS                      (2)
+#define TIMED_RUNS                       (8)
+
+typedef struct {
+    float G;
+    float drag;
+    int num_particles;
+    int num_fixed_particles;
+} state;
+
+typedef struct {
+    const char* name;
+    const char* path;
+    unsigned int program;
+    int tiled;
+} kernel;
+
+unsigned int load_compute_program(const char* path) {
+    char* code = LoadFileText(path);
+    if (code == NULL) return 0;
+    unsigned int shader = rlCompileShader(code, RL_COMPUTE_SHADER);
+    UnloadFileText(code);
+    return rlLoadComputeShaderProgram(shader);
+}
+
+void dispatch(kernel* k, int n) {
+    if (k->tiled) {
+        rlComputeShaderDispatch((n + FORCES_TILE_SIZE - 1) / FORCES_TILE_SIZE, 1, 1);
+    }
+    else {
+        // how main.c dispatched compute_forces.glsl
+        rlComputeShaderDispatch(n, 1, 1);
+    }
+}
+
+double run(kernel* k, int n, unsigned int ssboA, unsigned int ssboB, unsigned int ssboF, unsigned int info_buffer) {
+    state info = { 1e-4, 0.01, n, NUM_FIXED_PARTICLES };
+    rlUpdateShaderBuffer(info_buffer, &info, sizeof(state), 0);
+
+    rlEnableShader(k->program);
+    rlBindShaderBuffer(ssboA, 1);
+    rlBindShaderBuffer(ssboB, 2);
+    rlBindShaderBuffer(ssboF, 3);
+    rlBindShaderBuffer(info_buffer, 4);
+
+    for (int i = 0; i < WARMUP_RUNS; i++) {
+        dispatch(k, n);
+    }
+    glFinish();
+
+    double best = 1e30;
+    for (int i = 0; i < TIMED_RUNS; i++) {
+        double start = GetTime();
+        dispatch(k, n);
+        glFinish();
+        double elapsed = GetTime() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    rlDisableShader();
+
+    return best;
+}
+
+int main() {
+
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(64, 64, "bench_forces");
+
+    kernel kernels[] = {
+        { "naive", "resources/compute_forces.glsl", 0, 0 },
+        { "tiled", "resources/compute_forces_tiled.glsl", 0, 1 },
+    };
+    int num_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+    for (int i = 0; i < num_kernels; i++) {
+        kernels[i].program = load_compute_program(kernels[i].path);
+        if (kernels[i].program == 0) {
+            fprintf(stderr, "bench_forces: failed to load %s\n", kernels[i].path);
+            CloseWindow();
+            return 1;
+        }
+    }
+
+    particle* particles = calloc(MAX_PARTICLES, sizeof(particle));
+    particle* fixed_particles = calloc(MAX_PARTICLES, sizeof(particle));
+
+    // same density as a busy scene: everything inside the ring of fixed particles
+    srand(1);
+    for (int i = 0; i < MAX_PARTICLES; i++) {
+        float r = 350.0f * sqrtf((float)rand() / RAND_MAX);
+        float theta = 2 * PI * (float)rand() / RAND_MAX;
+        particles[i].position = (Vector2) { r * cosf(theta), r * sinf(theta) };
+        particles[i].mass.x = 1 + 99 * (float)rand() / RAND_MAX;
+    }
+    for (int i = 0; i < NUM_FIXED_PARTICLES; i++) {
+        float theta = 2 * PI * i / NUM_FIXED_PARTICLES;
+        fixed_particles[i].position = (Vector2) { 350.0f * cosf(theta), 350.0f * sinf(theta) };
+        fixed_particles[i].mass.x = 10000;
+    }
+
+    unsigned int ssboA = rlLoadShaderBuffer(sizeof(particle) * MAX_PARTICLES, particles, RL_DYNAMIC_COPY);
+    unsigned int ssboB = rlLoadShaderBuffer(sizeof(particle) * MAX_PARTICLES, particles, RL_DYNAMIC_COPY);
+    unsigned int ssboF = rlLoadShaderBuffer(sizeof(particle) * MAX_PARTICLES, fixed_particles, RL_DYNAMIC_COPY);
+    unsigned int info_buffer = rlLoadShaderBuffer(sizeof(state), NULL, RL_DYNAMIC_COPY);
+
+    printf("%-8s %10s %14s %16s\n", "kernel", "particles", "best (ms)", "pairs/sec");
+    for (int n = 1024; n <= MAX_PARTICLES; n *= 4) {
+        for (int i = 0; i < num_kernels; i++) {
+            double seconds = run(&kernels[i], n, ssboA, ssboB, ssboF, info_buffer);
+            double pairs = (double)n * (n + NUM_FIXED_PARTICLES);
+            printf("%-8s %10d %14.3f %16.4g\n", kernels[i].name, n, seconds * 1000.0, pairs / seconds);
+        }
+    }
+
+    rlUnloadShaderBuffer(ssboA);
+    rlUnloadShaderBuffer(ssboB);
+    rlUnloadShaderBuffer(ssboF);
+    rlUnloadShaderBuffer(info_buffer);
+    for (int i = 0; i < num_kernels; i++) {
+        rlUnloadShaderProgram(kernels[i].program);
+    }
+    free(particles);
+    free(fixed_particles);
+
+    CloseWindow();
+    return 0;
+}
@@ -0,0 +1,314 @@
+//
+// bench_kernels: timings of the noise and grid kernels, for tracking
+// regressions release over release. Every case is run a few times to
+// warm up, then timed REPS times (fewer for cases that would take longer
+// than CASE_BUDGET_MS), and reported as min, median and p99 per call.
+// The table goes to stderr and the JSON report to the given path:
+//
+//   make bench
+//   ./bench_kernels [report.json] [name filter]
+//
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rs.h"
+#include "rs_perlin.h"
+#include "rs_pool.h"
+#include "rs_normals.h"
+#include "rs_rand.h"
+
+#define WARMUP_RUNS      (3)
+#define REPS           (101)
+#define MIN_REPS         (5)
+#define CASE_BUDGET_MS (2000.0)
+#define NUM_POINTS    (4096)
+
+static const u32 grid_sizes[] = { 128, 512, 1024 };
+#define NUM_GRID_SIZES (sizeof(grid_sizes) / sizeof(grid_sizes[0]))
+
+typedef struct {
+    const char* name;
+    u32 size;                 // grid side, 0 for the point kernels
+    double items;             // points or cells per call
+    double min_ns, median_ns, p99_ns;
+    int reps;
+} result;
+
+// keeps the results of the kernels alive
+static volatile float sink;
+
+static double now_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+typedef void (*bench_fn)(void* ctx);
+
+static result run(const char* name, u32 size, double items, bench_fn fn, void* ctx) {
+    static double samples[REPS];
+
+    for (int i = 0; i < WARMUP_RUNS; i++) {
+        fn(ctx);
+    }
+    double start = now_ns();
+    int reps = 0;
+    while (reps < REPS) {
+        double t0 = now_ns();
+        fn(ctx);
+        samples[reps++] = now_ns() - t0;
+        if (reps >= MIN_REPS && now_ns() - start > CASE_BUDGET_MS * 1e6) break;
+    }
+    qsort(samples, reps, sizeof(double), compare_double);
+
+    result r;
+    r.name = name;
+    r.size = size;
+    r.items = items;
+    r.reps = reps;
+    r.min_ns = samples[0];
+    r.median_ns = samples[reps / 2];
+    // nearest rank
+    int p99 = (int)(0.99 * reps + 0.999999) - 1;
+    r.p99_ns = samples[p99 < 0 ? 0 : p99];
+
+    fprintf(stderr, "%-24s %6u %10.0f %14.3f %14.3f %14.3f %10.2f\n", name, size, items,
+            r.min_ns / 1e6, r.median_ns / 1e6, r.p99_ns / 1e6, r.min_ns / items);
+    return r;
+}
+
+//
+// point kernels, NUM_POINTS evaluations per call
+//
+
+typedef struct {
+    float x[NUM_POINTS];
+    float y[NUM_POINTS];
+    float z[NUM_POINTS];
+    float w[NUM_POINTS];
+    float out[NUM_POINTS];
+} points;
+
+static void bench_noise1(void* ctx) {
+    points* p = ctx;
+    float s = 0;
+    for (int i = 0; i < NUM_POINTS; i++) s += noise1(p->x[i]);
+    sink = s;
+}
+
+static void bench_noise2(void* ctx) {
+    points* p = ctx;
+    float s = 0;
+    for (int i = 0; i < NUM_POINTS; i++) s += noise2(p->x[i], p->y[i]);
+    sink = s;
+}
+
+static void bench_noise3(void* ctx) {
+    points* p = ctx;
+    float s = 0;
+    for (int i = 0; i < NUM_POINTS; i++) s += noise3(p->x[i], p->y[i], p->z[i]);
+    sink = s;
+}
+
+static void bench_noise4(void* ctx) {
+    points* p = ctx;
+    float s = 0;
+    for (int i = 0; i < NUM_POINTS; i++) s += noise4(p->x[i], p->y[i], p->z[i], p->w[i]);
+    sink = s;
+}
+
+// octaves of the world's base layer
+static void bench_cnoise2(void* ctx) {
+    points* p = ctx;
+    float s = 0;
+    for (int i = 0; i < NUM_POINTS; i++) s += cnoise2(p->x[i], p->y[i], 8, 0.5f, 2.0f);
+    sink = s;
+}
+
+static void bench_cnoise3(void* ctx) {
+    points* p = ctx;
+    float s = 0;
+    for (int i = 0; i < NUM_POINTS; i++) s += cnoise3(p->x[i], p->y[i], p->z[i], 8, 0.5f, 2.0f);
+    sink = s;
+}
+
+static void bench_cnoise2_batch(void* ctx) {
+    points* p = ctx;
+    cnoise2_batch(p->x, p->y, p->out, NUM_POINTS, 8, 0.5f, 2.0f);
+    sink = p->out[NUM_POINTS - 1];
+}
+
+static void bench_cnoise3_batch(void* ctx) {
+    points* p = ctx;
+    cnoise3_batch(p->x, p->y, p->z, p->out, NUM_POINTS, 8, 0.5f, 2.0f);
+    sink = p->out[NUM_POINTS - 1];
+}
+
+// the breakpoints of the world's offset curve
+static float linterp_fx[] = {  0.0,  0.80,   .89,   .90,   .91 };
+static float linterp_fy[] = { 20.0, 25.00, 85.00, 90.00, 95.00 };
+
+static void bench_linterp(void* ctx) {
+    points* p = ctx;
+    float s = 0;
+    for (int i = 0; i < NUM_POINTS; i++) s += linterp(p->w[i], linterp_fx, linterp_fy, 5);
+    sink = s;
+}
+
+//
+// grid kernels, one call over a size x size grid
+//
+
+typedef struct {
+    rs_grid* world;           // a generated map
+    rs_grid* scratch;
+    rs_light* light;
+    rs_normals* normals;      // of world, built once
+} grids;
+
+static void bench_perlin_fill(void* ctx) {
+    grids* g = ctx;
+    perlin_fill(g->scratch, 750.0f, 8.0f, 0.5f, 2.0f);
+    sink = g->scratch->data[0];
+}
+
+static void bench_grid_norm(void* ctx) {
+    grids* g = ctx;
+    rs_grid_norm(g->scratch, 100, 200);
+    sink = g->scratch->data[0];
+}
+
+static void bench_lighting(void* ctx) {
+    grids* g = ctx;
+    rs_calculate_lighting(g->scratch, g->world, g->light);
+    sink = g->scratch->data[0];
+}
+
+// the shading pass alone, what a moving light costs with cached normals
+static void bench_light_normals(void* ctx) {
+    grids* g = ctx;
+    rs_light_normals(g->scratch, g->world, g->normals, g->light);
+    sink = g->scratch->data[0];
+}
+
+static void bench_world_color(void* ctx) {
+    grids* g = ctx;
+    u32 s = 0;
+    for (u32 y = 0; y < g->world->height; y++) {
+        for (u32 x = 0; x < g->world->width; x++) {
+            Color c = calc_world_color(g->world, x, y, 0);
+            s += c.r + c.g + c.b;
+        }
+    }
+    sink = (float)s;
+}
+
+//
+// report
+//
+
+static int write_json(const char* path, result* results, int n) {
+    FILE* f = fopen(path, "w");
+    if (f == NULL) return 0;
+    fprintf(f, "{\n  \"suite\": \"rs_kernels\",\n  \"timestamp\": %ld,\n  \"threads\": %u,\n",
+            (long)time(NULL), rs_pool_size(rs_default_pool()));
+    fprintf(f, "  \"warmup_runs\": %d,\n  \"results\": [\n", WARMUP_RUNS);
+    for (int i = 0; i < n; i++) {
+        result* r = &results[i];
+        fprintf(f, "    { \"name\": \"%s\", \"size\": %u, \"items\": %.0f, \"reps\": %d, "
+                   "\"min_ns\": %.0f, \"median_ns\": %.0f, \"p99_ns\": %.0f, \"ns_per_item\": %.3f }%s\n",
+                r->name, r->size, r->items, r->reps, r->min_ns, r->median_ns, r->p99_ns,
+                r->min_ns / r->items, i + 1 < n ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+typedef struct {
+    const char* name;
+    bench_fn fn;
+} bench_case;
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "bench.json";
+    const char* filter = argc > 2 ? argv[2] : NULL;
+
+    static const bench_case point_cases[] = {
+        { "noise1", bench_noise1 },
+        { "noise2", bench_noise2 },
+        { "noise3", bench_noise3 },
+        { "noise4", bench_noise4 },
+        { "cnoise2", bench_cnoise2 },
+        { "cnoise3", bench_cnoise3 },
+        { "cnoise2_batch", bench_cnoise2_batch },
+        { "cnoise3_batch", bench_cnoise3_batch },
+        { "linterp", bench_linterp },
+    };
+    static const bench_case grid_cases[] = {
+        { "perlin_fill", bench_perlin_fill },
+        { "rs_grid_norm", bench_grid_norm },
+        { "rs_calculate_lighting", bench_lighting },
+        { "rs_light_normals", bench_light_normals },
+        { "calc_world_color", bench_world_color },
+    };
+    int num_point_cases = sizeof(point_cases) / sizeof(point_cases[0]);
+    int num_grid_cases = sizeof(grid_cases) / sizeof(grid_cases[0]);
+    result* results = malloc((num_point_cases + num_grid_cases * NUM_GRID_SIZES) * sizeof(result));
+    int n = 0;
+
+    fprintf(stderr, "%-24s %6s %10s %14s %14s %14s %10s\n",
+            "kernel", "size", "items", "min (ms)", "median (ms)", "p99 (ms)", "ns/item");
+
+    // fixed inputs over a few lattice cells of every octave
+    points* p = malloc(sizeof(points));
+    rs_rng rng = rs_make_rng(1, 0);
+    for (int i = 0; i < NUM_POINTS; i++) {
+        p->x[i] = rs_rng_range(&rng, -64.0f, 64.0f);
+        p->y[i] = rs_rng_range(&rng, -64.0f, 64.0f);
+        p->z[i] = rs_rng_range(&rng, -64.0f, 64.0f);
+        p->w[i] = rs_rng_float(&rng);
+    }
+    for (int c = 0; c < num_point_cases; c++) {
+        if (filter != NULL && strstr(point_cases[c].name, filter) == NULL) continue;
+        results[n++] = run(point_cases[c].name, 0, NUM_POINTS, point_cases[c].fn, p);
+    }
+    free(p);
+
+    for (u32 s = 0; s < NUM_GRID_SIZES; s++) {
+        u32 size = grid_sizes[s];
+        int any = filter == NULL;
+        for (int c = 0; c < num_grid_cases && !any; c++) {
+            any = strstr(grid_cases[c].name, filter) != NULL;
+        }
+        if (!any) continue;
+
+        rs_terra* t = rs_build_world(size, size);
+        grids g = { t->map, rs_make_grid(size, size), rs_make_light(size / 2.0f, size / 2.0f, 300.0f, 1.0f),
+                    rs_make_normals(t->map) };
+        perlin_fill(g.scratch, 750.0f, 8.0f, 0.5f, 2.0f);
+        for (int c = 0; c < num_grid_cases; c++) {
+            if (filter != NULL && strstr(grid_cases[c].name, filter) == NULL) continue;
+            results[n++] = run(grid_cases[c].name, size, (double)size * size, grid_cases[c].fn, &g);
+        }
+        rs_free_normals(g.normals);
+        rs_free_grid(g.scratch);
+        free(g.light);
+        rs_free_terra(t);
+    }
+
+    int ok = write_json(path, results, n);
+    if (!ok) fprintf(stderr, "bench_kernels: couldn't write %s\n", path);
+    else fprintf(stderr, "bench_kernels: wrote %d results to %s\n", n, path);
+    free(results);
+    return ok ? 0 : 1;
+}
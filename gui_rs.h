@@ -37,8 +37,10 @@ typedef struct {
     int ColorType;
     float ParticleScaleSliderValue;
     float ReplicationRateSliderValue;
+    int BrushMode;
+    float BrushRadiusSliderValue;
 
-    Rectangle layoutRecs[14];
+    Rectangle layoutRecs[17];
 
     // Custom state variables (depend on development software)
     // NOTE: This variables should be added manually if required
@@ -104,6 +106,8 @@ GuiRsState InitGuiRs(void)
     state.ColorType = 0;
     state.ParticleScaleSliderValue = 0.03f;
     state.ReplicationRateSliderValue = 0.0f;
+    state.BrushMode = 0;
+    state.BrushRadiusSliderValue = 20.0f;
 
     state.layoutRecs[0] = (Rectangle){ 24, 184, 360, 192 };
     state.layoutRecs[1] = (Rectangle){ 96, 208, 128, 24 };
@@ -119,6 +123,9 @@ GuiRsState InitGuiRs(void)
     state.layoutRecs[11] = (Rectangle){ 272, 296, 96, 24 };
     state.layoutRecs[12] = (Rectangle){ 280, 120, 88, 24 };
     state.layoutRecs[13] = (Rectangle){ 40, 336, 328, 24 };
+    state.layoutRecs[14] = (Rectangle){ 24, 640, 360, 96 };
+    state.layoutRecs[15] = (Rectangle){ 40, 656, 80, 24 };
+    state.layoutRecs[16] = (Rectangle){ 96, 696, 128, 24 };
 
     // Custom variables initialization
 
@@ -140,6 +147,9 @@ int GuiRs(GuiRsState *state)
     GuiSliderBar(state->layoutRecs[10], "Replication Rate", NULL, &state->ReplicationRateSliderValue, 0, 100);
     GuiLabel(state->layoutRecs[11], "ReplicationRateLabel");
     GuiLabel(state->layoutRecs[12], "ParticleScaleLabel");
+    GuiGroupBox(state->layoutRecs[14], "Brush");
+    GuiToggleGroup(state->layoutRecs[15], "Point;Spawn;Erase", &state->BrushMode);
+    GuiSliderBar(state->layoutRecs[16], "Radius", NULL, &state->BrushRadiusSliderValue, 1, 100);
     if (GuiButton(state->layoutRecs[13], "Clear Particles")) {
         return 1;
     }
@@ -20,6 +20,9 @@
 #include "raymath.h"
 
 #include "rs.h"
+#include "rs_particles.h"
+#include "rs_spatial.h"
+#include "rs_budget.h"
 
 #define WIDTH                         (1920)
 #define HEIGHT                        (1080)
@@ -44,18 +47,21 @@
 #define COLOR_TYPE_HALFTONE              (3)
 #define COLOR_TYPE_FIELD                 (4)
 
+#define BRUSH_MODE_POINT                 (0)
+#define BRUSH_MODE_SPAWN                 (1)
+#define BRUSH_MODE_ERASE                 (2)
+
+#define BRUSH_DENSITY                  (0.5)
+#define BRUSH_SPAWN_RATE              (2000)
+#define SPATIAL_CELL_SIZE               (10)
+
+#define FRAME_BUDGET_MS       (1000.0 / 60.0)
+
 typedef struct {
     Vector2 ul;
     Vector2 lr;
 } bb;
 
-typedef struct {
-    Vector2 position;
-    Vector2 velocity;
-    Vector2 acceleration;
-    Vector2 mass;
-} particle;
-
 typedef struct {
     void* data;
     unsigned int size;
@@ -72,10 +78,14 @@ typedef struct {
 typedef struct {
     int force_calculation_millis;
     int render_millis;
+    float frame_millis;
 } perf_stats;
 
 #define MAX_PARTICLES 50000
 
+// workgroup size of resources/compute_forces_tiled.glsl (TILE_SIZE)
+#define FORCES_TILE_SIZE               (256)
+
 Rectangle player = { 0, 0, 20, 20 };
 Camera2D camera = { 0 };
 state info = { GRAVITY, DRAG, 0, 0};
@@ -84,6 +94,12 @@ particle* fixed_particles;
 Vector2* positions;
 particle* dst_particles;
 Image targetImage;
+rs_grid* mass_field = NULL;
+rs_alias* mass_alias = NULL;
+int mass_field_mode = -1;
+u64 seed_counter = 0;
+rs_spatial* spatial;
+u32* brush_hits;
 
 unsigned int compute_forces_program;
 unsigned int ssboA;
@@ -94,7 +110,12 @@ unsigned int info_buffer;
 int show_gui = 0;
 GuiRsState gui_state;
 
-perf_stats stats = { 0, 0 };
+perf_stats stats = { 0, 0, 0 };
+
+rs_budget* budget;
+rs_quality quality;
+RenderTexture2D field_target;
+float field_target_scale = 0;
 
 float min(float a, float b, float c, float d) {
     float m = a;
@@ -161,6 +182,23 @@ float compute_charge_mass_at_point(const Image image, Vector2 world) {
     return rs_remap(b, 0.0, 1.0, MASS_LO, MASS_HI);
 }
 
+// mass of a BLANK sample, what compute_charge_mass_at_point() returns off the image
+float mass_outside_image() {
+    return (gui_state.ColorMode == COLOR_MODE_LIGHT) ? MASS_HI : MASS_LO;
+}
+
+void update_mass_field() {
+    if (mass_field_mode == gui_state.ColorMode) {
+        return;
+    }
+    if (mass_field != NULL) rs_free_grid(mass_field);
+    if (mass_alias != NULL) rs_free_alias(mass_alias);
+
+    mass_field = rs_make_mass_field(targetImage, gui_state.ColorMode == COLOR_MODE_LIGHT, MASS_LO, MASS_HI);
+    mass_alias = rs_make_alias(mass_field->data, mass_field->size);
+    mass_field_mode = gui_state.ColorMode;
+}
+
 void setup_camera() {
     camera.target = (Vector2){ player.x, player.y };
     camera.offset = (Vector2){ WIDTH/2.0, HEIGHT/2.0 };
@@ -186,6 +224,40 @@ void add_particle(Vector2 worldPosition) {
     }
 }
 
+void seed_particles(int n) {
+    if (n > MAX_PARTICLES - info.num_particles) {
+        n = MAX_PARTICLES - info.num_particles;
+    }
+    if (n <= 0) {
+        return;
+    }
+    update_mass_field();
+    rs_seed_particles(src_particles + info.num_particles, n, mass_alias, mass_field, seed_counter++, rs_default_pool());
+    info.num_particles += n;
+}
+
+// keeps the brush area filled to BRUSH_DENSITY particles per square unit
+void brush_spawn(Vector2 center, float radius) {
+    rs_spatial_build(spatial, src_particles, info.num_particles);
+    int existing = rs_spatial_query(spatial, src_particles, center, radius, NULL);
+    int wanted = (int)(BRUSH_DENSITY * PI * radius * radius) - existing;
+    if (wanted <= 0) {
+        return;
+    }
+    if (wanted > BRUSH_SPAWN_RATE) {
+        wanted = BRUSH_SPAWN_RATE;
+    }
+    update_mass_field();
+    info.num_particles += rs_spawn_particles(src_particles, info.num_particles, MAX_PARTICLES, wanted,
+                                             center, radius, mass_field, mass_outside_image(), seed_counter++);
+}
+
+void brush_erase(Vector2 center, float radius) {
+    rs_spatial_build(spatial, src_particles, info.num_particles);
+    u32 n = rs_spatial_query(spatial, src_particles, center, radius, brush_hits);
+    info.num_particles = rs_remove_particles(src_particles, info.num_particles, brush_hits, n);
+}
+
 void process_input() {
 
     if (IsKeyDown(KEY_RIGHT)) {
@@ -214,11 +286,27 @@ void process_input() {
         show_gui = !show_gui;
     }
 
+    if (IsKeyPressed(KEY_Q)) {
+        budget->enabled = !budget->enabled;
+    }
+
+    if (IsKeyPressed(KEY_F)) {
+        seed_particles(MAX_PARTICLES - info.num_particles);
+    }
+
     if (IsMouseButtonDown(0)) {
         Vector2 mousePosition = (Vector2) { GetMouseX(), GetMouseY() };
         if (mousePosition.x > 300) {
             Vector2 worldPosition = GetScreenToWorld2D(mousePosition, camera);
-            add_particle(worldPosition);
+            if (gui_state.BrushMode == BRUSH_MODE_SPAWN) {
+                brush_spawn(worldPosition, gui_state.BrushRadiusSliderValue);
+            }
+            else if (gui_state.BrushMode == BRUSH_MODE_ERASE) {
+                brush_erase(worldPosition, gui_state.BrushRadiusSliderValue);
+            }
+            else {
+                add_particle(worldPosition);
+            }
         }
     }
 
@@ -239,9 +327,10 @@ void process_input() {
 
 void compute_particle_forces() {
 
+    update_mass_field();
+    float outside_mass = mass_outside_image();
     for (int i = 0; i < info.num_particles; i++) {
-        particle p = src_particles[i];
-        src_particles[i].mass.x = compute_charge_mass_at_point(targetImage, src_particles[i].position);
+        src_particles[i].mass.x = rs_mass_field_at(mass_field, src_particles[i].position, outside_mass);
     }
 
     rlUpdateShaderBuffer(ssboA, src_particles, MAX_PARTICLES * sizeof(particle), 0);
@@ -252,7 +341,7 @@ void compute_particle_forces() {
     rlBindShaderBuffer(ssboB, 2);
     rlBindShaderBuffer(ssboF, 3);
     rlBindShaderBuffer(info_buffer, 4);
-    rlComputeShaderDispatch(info.num_particles, 1, 1);
+    rlComputeShaderDispatch((info.num_particles + FORCES_TILE_SIZE - 1) / FORCES_TILE_SIZE, 1, 1);
     rlDisableShader();
 
     rlReadShaderBuffer(ssboB, src_particles, sizeof(particle) * MAX_PARTICLES, 0);
@@ -264,19 +353,68 @@ void compute_particle_forces() {
 }
 
 void replicate_particles(int n) {
-    for(int i = 0; i < n; i++) {
-        int j = GetRandomValue(0, info.num_particles);
-        add_particle(src_particles[j].position);
+    if (n <= 0) {
+        return;
     }
+    update_mass_field();
+    info.num_particles += rs_replicate_particles(src_particles, info.num_particles, MAX_PARTICLES, n,
+                                                 mass_field, mass_outside_image(), seed_counter++, rs_default_pool());
 }
 
 void process_updates() {
     compute_particle_forces();
     if (info.num_particles > 0) {
-        replicate_particles((int)round(gui_state.ReplicationRateSliderValue));
+        replicate_particles((int)round(gui_state.ReplicationRateSliderValue * quality.replication_scale));
     }
 }
 
+// draws the field shader over the window, at field_scale of the window
+// resolution through an offscreen target when the budget asks for less
+void draw_field(Shader particleShader, float field_scale) {
+    Matrix view = MatrixInvert(GetCameraMatrix2D(camera));
+    if (field_scale >= 1.0f) {
+        SetShaderValueMatrix(particleShader, GetShaderLocation(particleShader, "view"), view);
+        rlEnableShader(particleShader.id);
+        rlBindShaderBuffer(ssboA, 1);
+        rlBindShaderBuffer(info_buffer, 2);
+        rlDisableShader();
+        BeginShaderMode(particleShader);
+        DrawRectangle(0, 0, WIDTH, HEIGHT, BLANK);
+        EndShaderMode();
+        return;
+    }
+
+    int w = (int)(WIDTH * field_scale);
+    int h = (int)(HEIGHT * field_scale);
+    if (field_target_scale != field_scale) {
+        if (field_target_scale > 0) {
+            UnloadRenderTexture(field_target);
+        }
+        field_target = LoadRenderTexture(w, h);
+        SetTextureFilter(field_target.texture, TEXTURE_FILTER_BILINEAR);
+        field_target_scale = field_scale;
+    }
+
+    // fragments of the small target cover 1/field_scale window pixels each
+    Matrix scaled_view = MatrixMultiply(MatrixScale(1.0f / field_scale, 1.0f / field_scale, 1.0f), view);
+    SetShaderValueMatrix(particleShader, GetShaderLocation(particleShader, "view"), scaled_view);
+    rlEnableShader(particleShader.id);
+    rlBindShaderBuffer(ssboA, 1);
+    rlBindShaderBuffer(info_buffer, 2);
+    rlDisableShader();
+
+    BeginTextureMode(field_target);
+    ClearBackground(BLANK);
+    BeginShaderMode(particleShader);
+    DrawRectangle(0, 0, w, h, BLANK);
+    EndShaderMode();
+    EndTextureMode();
+
+    // render textures are stored upside down
+    DrawTexturePro(field_target.texture, (Rectangle) { 0, 0, w, -h }, (Rectangle) { 0, 0, WIDTH, HEIGHT },
+                   (Vector2) { 0, 0 }, 0.0f, WHITE);
+}
+
 void show_debug_info() {
     
 
@@ -302,6 +440,9 @@ void show_debug_info() {
     DrawText(buffer, 30, 560, 10, BLACK);
     sprintf(buffer, "         Rendering (ms) = %d", stats.render_millis);
     DrawText(buffer, 30, 580, 10, BLACK);
+    sprintf(buffer, "  Quality = %d/%d %s, Frame (ms) = %.1f/%.1f", budget->level, rs_budget_levels() - 1,
+            budget->enabled ? "(auto)" : "(off)", budget->frame_ms, budget->budget_ms);
+    DrawText(buffer, 30, 600, 10, BLACK);
 
     DrawFPS(30, GetScreenHeight() - 100);
 
@@ -316,7 +457,7 @@ int main() {
 
     setup_camera();
 
-    char *compute_forces_code = LoadFileText("resources/compute_forces.glsl");
+    char *compute_forces_code = LoadFileText("resources/compute_forces_tiled.glsl");
     unsigned int compute_forces_shader = rlCompileShader(compute_forces_code, RL_COMPUTE_SHADER);
     compute_forces_program = rlLoadComputeShaderProgram(compute_forces_shader);
     UnloadFileText(compute_forces_code);
@@ -330,6 +471,10 @@ int main() {
     dst_particles = malloc(MAX_PARTICLES * sizeof(particle));
     fixed_particles = malloc(MAX_PARTICLES * sizeof(particle));
     positions = malloc(MAX_PARTICLES * sizeof(Vector2));
+    brush_hits = malloc(MAX_PARTICLES * sizeof(u32));
+    spatial = rs_make_spatial(SPATIAL_CELL_SIZE);
+    budget = rs_make_budget(FRAME_BUDGET_MS);
+    quality = rs_budget_quality(budget);
     memcpy(dst_particles, src_particles, sizeof(particle) * MAX_PARTICLES);
 
     float r = 350;
@@ -359,12 +504,14 @@ int main() {
     /*targetImage = LoadImage("resources/Rape_of_Prosepina.png");*/
     /*targetImage = LoadImage("resources/pictures/dg_sunset.png");*/
     targetImage = LoadImage("resources/pictures/lindell.png");
+    seed_counter = (u64)time(NULL);
     /*gammaField = LoadImage("resources/gl.png");*/
 
     GuiLoadStyle("resources/styles/jungle/style_jungle.rgs");
 
     while (!WindowShouldClose()) {
 
+        double frame_start = GetTime();
         process_input();
 
 
@@ -379,15 +526,7 @@ int main() {
         }
 
         if (gui_state.ColorType == COLOR_TYPE_FIELD) {
-            Matrix view = MatrixInvert(GetCameraMatrix2D(camera));
-            SetShaderValueMatrix(particleShader, GetShaderLocation(particleShader, "view"), view);
-            rlEnableShader(particleShader.id);
-            rlBindShaderBuffer(ssboA, 1);
-            rlBindShaderBuffer(info_buffer, 2);
-            rlDisableShader();
-            BeginShaderMode(particleShader);
-            DrawRectangle(0, 0, WIDTH, HEIGHT, BLANK);
-            EndShaderMode();
+            draw_field(particleShader, quality.field_scale);
 
             /*
             SetShaderValueMatrix(electric_field_shader, GetShaderLocation(electric_field_shader, "view"), view);
@@ -405,7 +544,7 @@ int main() {
         else {
 
             if (gui_state.ParticleScaleSliderValue < 0.0001) {
-                for (int i = 0; i < info.num_particles; i++) {
+                for (int i = 0; i < info.num_particles; i += quality.particle_stride) {
                     particle p = src_particles[i];
                     Color c = get_particle_color(p);
                     /*Vector2 screen = GetWorldToScreen2D(p.position, camera);*/
@@ -414,7 +553,7 @@ int main() {
             }
             else {
                 BeginMode2D(camera);
-                for (int i = 0; i < info.num_particles; i++) {
+                for (int i = 0; i < info.num_particles; i += quality.particle_stride) {
                     particle p = src_particles[i];
                     Color c = get_particle_color(p);
                     float r = gui_state.ParticleScaleSliderValue * p.mass.x;
@@ -424,6 +563,14 @@ int main() {
             }
         }
 
+        if (gui_state.BrushMode != BRUSH_MODE_POINT) {
+            Vector2 mousePosition = (Vector2) { GetMouseX(), GetMouseY() };
+            BeginMode2D(camera);
+            DrawCircleLinesV(GetScreenToWorld2D(mousePosition, camera), gui_state.BrushRadiusSliderValue,
+                             gui_state.ColorMode == COLOR_MODE_DARK ? WHITE : BLACK);
+            EndMode2D();
+        }
+
         if (show_gui) {
             if (GuiRs(&gui_state) == 1) {
                 memset(src_particles, 0, MAX_PARTICLES * sizeof(particle));
@@ -447,7 +594,17 @@ int main() {
         clock_t update_end = clock();
 
         stats.force_calculation_millis = ((double)(update_end - update_start)) / CLOCKS_PER_SEC * 1000;
+
+        // wall time, clock() counts the cpu time of every pool thread
+        stats.frame_millis = (GetTime() - frame_start) * 1000;
+        rs_budget_update(budget, stats.frame_millis);
+        quality = rs_budget_quality(budget);
+    }
+
+    if (field_target_scale > 0) {
+        UnloadRenderTexture(field_target);
     }
+    rs_free_budget(budget);
 
     rlUnloadShaderBuffer(ssboA);
     rlUnloadShaderBuffer(ssboB);
@@ -0,0 +1,113 @@
+#version 430
+
+#define EPSILON 0.5
+#define MAX_SEARCH_DISTANCE 50
+#define TIME_STEP 1.0
+
+// must match FORCES_TILE_SIZE in main.c, the host dispatches
+// ceil(num_particles / TILE_SIZE) workgroups
+#define TILE_SIZE 256
+
+layout (local_size_x = TILE_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+struct particle {
+    vec2 position;
+    vec2 v; // velocity
+    vec2 a; // acceleration
+    vec2 m; // mass
+};
+
+struct state {
+    float G;
+    float drag;
+    int num_particles;
+    int num_fixed_particles;
+};
+
+layout (std430, binding = 1) readonly restrict buffer gLayout1 {
+    particle src[];
+};
+
+layout (std430, binding = 2) writeonly restrict buffer gLayout2 {
+    particle dst[];
+};
+
+layout (std430, binding = 3) readonly restrict buffer gLayout3 {
+    particle fixed_particles[];
+};
+
+layout (std430, binding = 4) readonly restrict buffer gLayout4 {
+    state info;
+};
+
+// xy = position, z = mass
+shared vec4 tile[TILE_SIZE];
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    uint lid = gl_LocalInvocationID.x;
+    uint n = uint(info.num_particles);
+    uint nf = uint(info.num_fixed_particles);
+
+    // invocations past the end still help load tiles, every invocation
+    // in the workgroup has to reach each barrier()
+    bool active = i < n;
+    particle left = src[active ? i : 0u];
+    vec2 force = vec2(0,0);
+
+    for (uint base = 0u; base < n; base += TILE_SIZE) {
+        uint j = base + lid;
+        tile[lid] = (j < n) ? vec4(src[j].position, src[j].m.x, 0.0) : vec4(0.0);
+        barrier();
+
+        if (active) {
+            uint count = min(uint(TILE_SIZE), n - base);
+            for (uint k = 0u; k < count; k++) {
+                if (base + k != i) {
+                    vec4 right = tile[k];
+                    vec2 r = left.position - right.xy;
+                    float dist = sqrt(r.x*r.x + r.y*r.y);
+                    if (dist > EPSILON && dist < MAX_SEARCH_DISTANCE) {
+                        float F = info.G * (left.m.x * right.z) / (dist * dist);
+                        force += F * r / dist;
+                    }
+                }
+            }
+        }
+        barrier();
+    }
+
+    for (uint base = 0u; base < nf; base += TILE_SIZE) {
+        uint j = base + lid;
+        tile[lid] = (j < nf) ? vec4(fixed_particles[j].position, fixed_particles[j].m.x, 0.0) : vec4(0.0);
+        barrier();
+
+        if (active) {
+            uint count = min(uint(TILE_SIZE), nf - base);
+            for (uint k = 0u; k < count; k++) {
+                // same index skip as compute_forces.glsl
+                if (base + k != i) {
+                    vec4 right = tile[k];
+                    vec2 r = left.position - right.xy;
+                    float dist = distance(left.position, right.xy);
+                    if (dist < EPSILON) dist = EPSILON;
+                    vec2 dir = r / dist;
+                    float F = info.G * (left.m.x * right.z) / (dist * dist);
+                    force += F * dir;
+                }
+            }
+        }
+        barrier();
+    }
+
+    if (active) {
+        // F = ma => a = F/m
+        vec2 new_position = left.position + left.v;
+
+        vec2 a = force / (left.m.x);
+        dst[i].position = new_position;
+        dst[i].v = left.v + (TIME_STEP * left.a) - info.drag * left.v;
+        dst[i].a = a;
+        dst[i].m.x = left.m.x;
+    }
+}
@@ -1,4 +1,3 @@
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -6,13 +5,20 @@
 #include <time.h>
 #include "rs.h"
 #include "rs_perlin.h"
+#include "rs_simplex.h"
+#include "rs_pool.h"
+#include "rs_curve.h"
+#include "rs_stats.h"
+#include "rs_normals.h"
+#include "rs_world_file.h"
+#include "rs_rand.h"
 
 //
 // utility functions
 //
 
-float rand_range(float range) {
-    return ((float)rand() / RAND_MAX) * 2 * range - range;
+float rand_range(rs_rng* rng, float range) {
+    return rs_rng_float(rng) * 2 * range - range;
 }
 
 int index(int x, int y, int size) {
@@ -76,62 +82,508 @@ float rs_remap(float value, float input_min, float input_max, float output_min,
 // terrain functions
 //
 
-void perlin_fill(rs_grid* g, float scale, float octaves, float persistence, float lacunarity) {
-    for (u32 y = 0; y < g->height; y++) {
-        for (u32 x = 0; x < g->width; x++) {
-            float noise = cnoise2((float)x/scale, (float)y/scale, octaves, persistence, lacunarity);
-            rs_grid_set(g, x, y, noise);
+void noise_fill_rect(u32 engine, const rs_noise* noise, float* dst, u32 stride, int x0, int y0, u32 w, u32 h,
+                     u32 step, float footprint, float scale, float octaves, float persistence, float lacunarity) {
+    float xs[RS_TILE_SIZE];
+    float ys[RS_TILE_SIZE];
+
+    for (u32 bx = 0; bx < w; bx += RS_TILE_SIZE) {
+        u32 bw = w - bx < RS_TILE_SIZE ? w - bx : RS_TILE_SIZE;
+        for (u32 i = 0; i < bw; i++) {
+            xs[i] = (float)(x0 + (int)((bx + i) * step))/scale;
+        }
+        for (u32 y = 0; y < h; y++) {
+            float fy = (float)(y0 + (int)(y * step))/scale;
+            for (u32 i = 0; i < bw; i++) {
+                ys[i] = fy;
+            }
+            float* out = &dst[bx + y * stride];
+            if (engine == RS_NOISE_SIMPLEX) {
+                if (footprint > 0) csnoise2_filtered_batch_ctx(noise, xs, ys, out, bw, footprint, octaves, persistence, lacunarity);
+                else csnoise2_batch_ctx(noise, xs, ys, out, bw, octaves, persistence, lacunarity);
+            }
+            else {
+                if (footprint > 0) cnoise2_filtered_batch_ctx(noise, xs, ys, out, bw, footprint, octaves, persistence, lacunarity);
+                else cnoise2_batch_ctx(noise, xs, ys, out, bw, octaves, persistence, lacunarity);
+            }
         }
     }
 }
 
+void perlin_fill_rect(const rs_noise* noise, float* dst, u32 stride, int x0, int y0, u32 w, u32 h,
+                      float scale, float octaves, float persistence, float lacunarity) {
+    noise_fill_rect(RS_NOISE_PERLIN, noise, dst, stride, x0, y0, w, h, 1, 0, scale, octaves, persistence, lacunarity);
+}
+
+void perlin_fill_rect_lod(const rs_noise* noise, float* dst, u32 stride, int x0, int y0, u32 w, u32 h, u32 step,
+                          float scale, float octaves, float persistence, float lacunarity) {
+    noise_fill_rect(RS_NOISE_PERLIN, noise, dst, stride, x0, y0, w, h, step, (float)step / scale,
+                    scale, octaves, persistence, lacunarity);
+}
+
+void perlin_fill_rect_deriv(const rs_noise* noise, float* dst, float* sx, float* sy, u32 stride, int x0, int y0, u32 w, u32 h,
+                            float scale, float octaves, float persistence, float lacunarity) {
+    float xs[RS_TILE_SIZE];
+    float ys[RS_TILE_SIZE];
+    float inv_scale = 1.0f / scale;
 
-rs_terra* rs_build_world(u32 w, u32 h) {
+    for (u32 bx = 0; bx < w; bx += RS_TILE_SIZE) {
+        u32 bw = w - bx < RS_TILE_SIZE ? w - bx : RS_TILE_SIZE;
+        for (u32 i = 0; i < bw; i++) {
+            xs[i] = (float)(x0 + (int)(bx + i))/scale;
+        }
+        for (u32 y = 0; y < h; y++) {
+            float fy = (float)(y0 + (int)y)/scale;
+            for (u32 i = 0; i < bw; i++) {
+                ys[i] = fy;
+            }
+            u32 at = bx + y * stride;
+            cnoise2_deriv_batch_ctx(noise, xs, ys, &dst[at], &sx[at], &sy[at], bw, octaves, persistence, lacunarity);
+            // per noise unit to per cell
+            for (u32 i = 0; i < bw; i++) {
+                sx[at + i] *= inv_scale;
+                sy[at + i] *= inv_scale;
+            }
+        }
+    }
+}
+
+typedef struct {
+    const rs_noise* noise;
+    rs_grid* g;
+    rs_grid* sx;
+    rs_grid* sy;
+    float scale;
+    float octaves;
+    float persistence;
+    float lacunarity;
+    u32 tiles_x;
+} perlin_fill_job;
+
+void perlin_fill_tiles(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    perlin_fill_job* job = ctx;
+    rs_grid* g = job->g;
+
+    for (u32 tile = begin; tile < end; tile++) {
+        u32 x0 = (tile % job->tiles_x) * RS_TILE_SIZE;
+        u32 y0 = (tile / job->tiles_x) * RS_TILE_SIZE;
+        u32 x1 = x0 + RS_TILE_SIZE < g->width ? x0 + RS_TILE_SIZE : g->width;
+        u32 y1 = y0 + RS_TILE_SIZE < g->height ? y0 + RS_TILE_SIZE : g->height;
+        u32 at = x0 + y0 * g->width;
+        if (job->sx != NULL) {
+            perlin_fill_rect_deriv(job->noise, &g->data[at], &job->sx->data[at], &job->sy->data[at], g->width,
+                                   x0, y0, x1 - x0, y1 - y0, job->scale, job->octaves, job->persistence, job->lacunarity);
+        }
+        else {
+            perlin_fill_rect(job->noise, &g->data[at], g->width, x0, y0, x1 - x0, y1 - y0,
+                             job->scale, job->octaves, job->persistence, job->lacunarity);
+        }
+    }
+}
+
+void perlin_fill_ctx(const rs_noise* noise, rs_grid* g, float scale, float octaves, float persistence, float lacunarity) {
+    u32 tiles_x = (g->width + RS_TILE_SIZE - 1) / RS_TILE_SIZE;
+    u32 tiles_y = (g->height + RS_TILE_SIZE - 1) / RS_TILE_SIZE;
+    perlin_fill_job job = { noise, g, NULL, NULL, scale, octaves, persistence, lacunarity, tiles_x };
+    rs_pool_parallel_for(rs_default_pool(), tiles_x * tiles_y, 1, perlin_fill_tiles, &job);
+}
+
+void perlin_fill_slopes(const rs_noise* noise, rs_grid* g, rs_grid* sx, rs_grid* sy,
+                        float scale, float octaves, float persistence, float lacunarity) {
+    if (sx->size != g->size || sy->size != g->size) return;
+    u32 tiles_x = (g->width + RS_TILE_SIZE - 1) / RS_TILE_SIZE;
+    u32 tiles_y = (g->height + RS_TILE_SIZE - 1) / RS_TILE_SIZE;
+    perlin_fill_job job = { noise, g, sx, sy, scale, octaves, persistence, lacunarity, tiles_x };
+    rs_pool_parallel_for(rs_default_pool(), tiles_x * tiles_y, 1, perlin_fill_tiles, &job);
+}
+
+void perlin_fill(rs_grid* g, float scale, float octaves, float persistence, float lacunarity) {
+    perlin_fill_ctx(rs_default_noise(), g, scale, octaves, persistence, lacunarity);
+}
+
+float offset_fx[] = {  0.0,  0.80,   .89,   .90,   .91 };
+float offset_fy[] = { 20.0, 25.00, 85.00, 90.00, 95.00 };
+int offset_n = 5;
+
+float erosion_fx[] = {   0.0,  0.1, 0.8,   .92,   .99 };
+float erosion_fy[] = { 100.0, 80.0, 3.0,  2.00,   .30 };
+int erosion_n = 4;
+
+rs_curve* make_offset_curve() {
+    return rs_make_curve(offset_fx, offset_fy, offset_n, RS_CURVE_LUT_SIZE);
+}
+
+rs_curve* make_erosion_curve() {
+    return rs_make_curve(erosion_fx, erosion_fy, erosion_n, RS_CURVE_LUT_SIZE);
+}
 
-    rs_grid* base = rs_make_grid(w, h);
-    perlin_fill(base, 750.0, 8.0, 0.5, 2.0);
-    rs_grid_norm(base, -0.25, 1);
+rs_world_params rs_default_world_params() {
+    rs_world_params p = {
+        .base            = {  750.0, 8.0, 0.5, 2.0, -0.25, 1, 0 },
+        .continentalness = {  500.0, 2.0, 0.5, 2.0,     0, 1, 0 },
+        .erosion         = { 1000.0, 1.0, 2.0, 1.1,     0, 1, 0 },
+        .map_lo = 100,
+        .map_hi = 200,
+    };
+    return p;
+}
 
-    rs_grid* continentalness = rs_make_grid(w, h);
-    perlin_fill(continentalness, 500.0, 2.0, 0.5, 2.0);
-    rs_grid_norm(continentalness, 0, 1);
+//
+// the world is built in three passes over RS_TILE_SIZE tiles:
+//   1. noise for every layer, keeping the per-layer bounds. the base layer,
+//      by far the most expensive, is stored (in the map grid when the
+//      caller doesn't keep it), the cheap low octave layers are only
+//      stored when kept
+//   2. normalize and combine the layers into the map while the tile is in
+//      cache, recomputing the layers that weren't stored, and keep the
+//      map bounds
+//   3. normalize the map in place
+//
 
-    float offset_fx[] = {  0.0,  0.80,   .89,   .90,   .91 };
-    float offset_fy[] = { 20.0, 25.00, 85.00, 90.00, 95.00 };
-    float offset_n = 5;
+enum { BOUNDS_BASE, BOUNDS_CONTINENTALNESS, BOUNDS_EROSION, BOUNDS_MAP, NUM_BOUNDS };
 
-    rs_grid* erosion = rs_make_grid(w, h);
-    perlin_fill(erosion, 1000.0, 1.0, 2.0, 1.1);
-    rs_grid_norm(erosion, 0, 1);
-    float erosion_fx[] = {   0.0,  0.1, 0.8,   .92,   .99 };
-    float erosion_fy[] = { 100.0, 80.0, 3.0,  2.00,   .30 };
-    float erosion_n = 4;
+// noise tables of the layers, made from their seeds once per build
+typedef struct {
+    rs_noise base;
+    rs_noise continentalness;
+    rs_noise erosion;
+} world_noise;
 
-    rs_grid* map = rs_make_grid(w, h);
+void world_noise_init(world_noise* n, rs_world_params* params) {
+    rs_noise_init(&n->base, params->base.seed);
+    rs_noise_init(&n->continentalness, params->continentalness.seed);
+    rs_noise_init(&n->erosion, params->erosion.seed);
+}
+
+typedef struct {
+    rs_world_params* params;
+    world_noise noise;
+    rs_grid* base;
+    rs_grid* continentalness;
+    rs_grid* erosion;
+    rs_grid* map;
+    rs_curve* offset_curve;
+    rs_curve* erosion_curve;
+    u32 tiles_x;
+    float* lo;
+    float* hi;
+    float min[NUM_BOUNDS];
+    float max[NUM_BOUNDS];
+} world_job;
+
+void track_bounds(world_job* job, u32 worker, int which, float* v, u32 w, u32 h, u32 stride) {
+    rs_range r = { job->lo[worker * NUM_BOUNDS + which], job->hi[worker * NUM_BOUNDS + which] };
     for (u32 y = 0; y < h; y++) {
-        for (u32 x = 0; x < w; x++) {
-            float offset = linterp(rs_grid_get(continentalness, x, y), offset_fx, offset_fy, offset_n);
-            float scale = linterp(rs_grid_get(erosion, x, y), erosion_fx, erosion_fy, erosion_n);
-            rs_grid_set(map, x, y, offset + scale * rs_grid_get(base, x, y));
+        r = rs_range_merge(r, &v[y * stride], w);
+    }
+    job->lo[worker * NUM_BOUNDS + which] = r.min;
+    job->hi[worker * NUM_BOUNDS + which] = r.max;
+}
+
+void layer_fill_rect(float* dst, u32 stride, u32 x0, u32 y0, u32 w, u32 h, rs_layer_params* l, const rs_noise* noise) {
+    noise_fill_rect(l->engine, noise, dst, stride, x0, y0, w, h, 1, 0, l->scale, l->octaves, l->persistence, l->lacunarity);
+}
+
+// every step-th cell, step 1 is layer_fill_rect
+void layer_fill_rect_lod(float* dst, u32 stride, int x0, int y0, u32 w, u32 h, u32 step,
+                         rs_layer_params* l, const rs_noise* noise) {
+    float footprint = step > 1 ? (float)step / l->scale : 0;
+    noise_fill_rect(l->engine, noise, dst, stride, x0, y0, w, h, step, footprint,
+                    l->scale, l->octaves, l->persistence, l->lacunarity);
+}
+
+void world_tile_rect(world_job* job, u32 tile, u32* x0, u32* y0, u32* w, u32* h) {
+    u32 width = job->map->width;
+    u32 height = job->map->height;
+    *x0 = (tile % job->tiles_x) * RS_TILE_SIZE;
+    *y0 = (tile / job->tiles_x) * RS_TILE_SIZE;
+    *w = width - *x0 < RS_TILE_SIZE ? width - *x0 : RS_TILE_SIZE;
+    *h = height - *y0 < RS_TILE_SIZE ? height - *y0 : RS_TILE_SIZE;
+}
+
+void world_noise_tiles(void* ctx, u32 begin, u32 end, u32 worker) {
+    world_job* job = ctx;
+    u32 stride = job->map->width;
+    float scratch[RS_TILE_SIZE * RS_TILE_SIZE];
+
+    for (u32 tile = begin; tile < end; tile++) {
+        u32 x0, y0, w, h;
+        world_tile_rect(job, tile, &x0, &y0, &w, &h);
+        u32 offset = x0 + y0 * stride;
+
+        float* base = &job->base->data[offset];
+        layer_fill_rect(base, stride, x0, y0, w, h, &job->params->base, &job->noise.base);
+        track_bounds(job, worker, BOUNDS_BASE, base, w, h, stride);
+
+        if (job->continentalness != NULL) {
+            float* c = &job->continentalness->data[offset];
+            layer_fill_rect(c, stride, x0, y0, w, h, &job->params->continentalness, &job->noise.continentalness);
+            track_bounds(job, worker, BOUNDS_CONTINENTALNESS, c, w, h, stride);
+        }
+        else {
+            layer_fill_rect(scratch, RS_TILE_SIZE, x0, y0, w, h, &job->params->continentalness, &job->noise.continentalness);
+            track_bounds(job, worker, BOUNDS_CONTINENTALNESS, scratch, w, h, RS_TILE_SIZE);
+        }
+
+        if (job->erosion != NULL) {
+            float* e = &job->erosion->data[offset];
+            layer_fill_rect(e, stride, x0, y0, w, h, &job->params->erosion, &job->noise.erosion);
+            track_bounds(job, worker, BOUNDS_EROSION, e, w, h, stride);
+        }
+        else {
+            layer_fill_rect(scratch, RS_TILE_SIZE, x0, y0, w, h, &job->params->erosion, &job->noise.erosion);
+            track_bounds(job, worker, BOUNDS_EROSION, scratch, w, h, RS_TILE_SIZE);
+        }
+    }
+}
+
+void world_combine_tiles(void* ctx, u32 begin, u32 end, u32 worker) {
+    world_job* job = ctx;
+    rs_world_params* params = job->params;
+    u32 stride = job->map->width;
+    float c_scratch[RS_TILE_SIZE * RS_TILE_SIZE];
+    float e_scratch[RS_TILE_SIZE * RS_TILE_SIZE];
+
+    for (u32 tile = begin; tile < end; tile++) {
+        u32 x0, y0, w, h;
+        world_tile_rect(job, tile, &x0, &y0, &w, &h);
+        u32 offset = x0 + y0 * stride;
+
+        float* c = c_scratch;
+        u32 c_stride = RS_TILE_SIZE;
+        if (job->continentalness != NULL) {
+            c = &job->continentalness->data[offset];
+            c_stride = stride;
+        }
+        else {
+            layer_fill_rect(c, c_stride, x0, y0, w, h, &params->continentalness, &job->noise.continentalness);
+        }
+
+        float* e = e_scratch;
+        u32 e_stride = RS_TILE_SIZE;
+        if (job->erosion != NULL) {
+            e = &job->erosion->data[offset];
+            e_stride = stride;
+        }
+        else {
+            layer_fill_rect(e, e_stride, x0, y0, w, h, &params->erosion, &job->noise.erosion);
+        }
+
+        float* base = &job->base->data[offset];
+        float* map = &job->map->data[offset];
+        float height[RS_TILE_SIZE];
+        float relief[RS_TILE_SIZE];
+        for (u32 y = 0; y < h; y++) {
+            // kept layers are handed back normalized
+            float* cn = &c[y * c_stride];
+            float* en = &e[y * e_stride];
+            float* bn = &base[y * stride];
+            rs_span_remap(cn, w, job->min[BOUNDS_CONTINENTALNESS], job->max[BOUNDS_CONTINENTALNESS],
+                          params->continentalness.lo, params->continentalness.hi);
+            rs_span_remap(en, w, job->min[BOUNDS_EROSION], job->max[BOUNDS_EROSION],
+                          params->erosion.lo, params->erosion.hi);
+            rs_span_remap(bn, w, job->min[BOUNDS_BASE], job->max[BOUNDS_BASE],
+                          params->base.lo, params->base.hi);
+            rs_curve_eval_bulk(job->offset_curve, cn, height, w);
+            rs_curve_eval_bulk(job->erosion_curve, en, relief, w);
+            for (u32 x = 0; x < w; x++) {
+                map[x + y * stride] = height[x] + relief[x] * bn[x];
+            }
         }
+        track_bounds(job, worker, BOUNDS_MAP, map, w, h, stride);
     }
+}
 
-    rs_grid_norm(map, 100, 200);
+void reduce_bounds(world_job* job, u32 workers, int which) {
+    job->min[which] = FLT_MAX;
+    job->max[which] = -FLT_MAX;
+    for (u32 i = 0; i < workers; i++) {
+        if (job->lo[i * NUM_BOUNDS + which] < job->min[which]) job->min[which] = job->lo[i * NUM_BOUNDS + which];
+        if (job->hi[i * NUM_BOUNDS + which] > job->max[which]) job->max[which] = job->hi[i * NUM_BOUNDS + which];
+    }
+}
+
+rs_terra* build_world(u32 w, u32 h, rs_world_params* params, u32 keep, rs_world_bounds* bounds) {
+    rs_pool* pool = rs_default_pool();
+    u32 workers = rs_pool_size(pool);
 
     rs_terra* world = malloc(sizeof(rs_terra));
-    world->base = base;
-    world->continentalness = continentalness;
-    world->erosion = erosion;
-    world->map = map;
- 
+    world->map = rs_make_grid(w, h);
+    world->base = (keep & RS_LAYER_BASE) ? rs_make_grid(w, h) : NULL;
+    world->continentalness = (keep & RS_LAYER_CONTINENTALNESS) ? rs_make_grid(w, h) : NULL;
+    world->erosion = (keep & RS_LAYER_EROSION) ? rs_make_grid(w, h) : NULL;
+    world->normals = NULL;
+    world->mapping = NULL;
+    world->mapping_bytes = 0;
+
+    world_job job;
+    job.params = params;
+    world_noise_init(&job.noise, params);
+    job.base = world->base != NULL ? world->base : world->map;
+    job.continentalness = world->continentalness;
+    job.erosion = world->erosion;
+    job.map = world->map;
+    job.offset_curve = make_offset_curve();
+    job.erosion_curve = make_erosion_curve();
+    job.tiles_x = (w + RS_TILE_SIZE - 1) / RS_TILE_SIZE;
+    job.lo = malloc(workers * NUM_BOUNDS * sizeof(float));
+    job.hi = malloc(workers * NUM_BOUNDS * sizeof(float));
+    for (u32 i = 0; i < workers * NUM_BOUNDS; i++) {
+        job.lo[i] = FLT_MAX;
+        job.hi[i] = -FLT_MAX;
+    }
+
+    u32 num_tiles = job.tiles_x * ((h + RS_TILE_SIZE - 1) / RS_TILE_SIZE);
+    rs_pool_parallel_for(pool, num_tiles, 1, world_noise_tiles, &job);
+    reduce_bounds(&job, workers, BOUNDS_BASE);
+    reduce_bounds(&job, workers, BOUNDS_CONTINENTALNESS);
+    reduce_bounds(&job, workers, BOUNDS_EROSION);
+
+    rs_pool_parallel_for(pool, num_tiles, 1, world_combine_tiles, &job);
+    reduce_bounds(&job, workers, BOUNDS_MAP);
+
+    rs_grid_remap(world->map, job.min[BOUNDS_MAP], job.max[BOUNDS_MAP], params->map_lo, params->map_hi);
+
+    if (bounds != NULL) {
+        bounds->base_min = job.min[BOUNDS_BASE];
+        bounds->base_max = job.max[BOUNDS_BASE];
+        bounds->continentalness_min = job.min[BOUNDS_CONTINENTALNESS];
+        bounds->continentalness_max = job.max[BOUNDS_CONTINENTALNESS];
+        bounds->erosion_min = job.min[BOUNDS_EROSION];
+        bounds->erosion_max = job.max[BOUNDS_EROSION];
+        bounds->map_min = job.min[BOUNDS_MAP];
+        bounds->map_max = job.max[BOUNDS_MAP];
+    }
+
+    rs_free_curve(job.offset_curve);
+    rs_free_curve(job.erosion_curve);
+    free(job.lo);
+    free(job.hi);
     return world;
 }
 
+rs_terra* rs_build_world_layers(u32 w, u32 h, rs_world_params* params, u32 keep) {
+    return build_world(w, h, params, keep, NULL);
+}
+
+rs_world_bounds rs_measure_world_bounds(rs_world_params* params, u32 w, u32 h) {
+    rs_world_bounds bounds;
+    rs_free_terra(build_world(w, h, params, 0, &bounds));
+    return bounds;
+}
+
+//
+// with the bounds fixed up front every cell only depends on its own world
+// coordinate, so a rect is a single fused pass over its tiles and any two
+// rects agree wherever they touch or overlap
+//
+
+typedef struct {
+    rs_world_params* params;
+    world_noise noise;
+    rs_world_bounds* bounds;
+    rs_grid* map;
+    rs_curve* offset_curve;
+    rs_curve* erosion_curve;
+    int x0, y0;
+    u32 step;
+    u32 tiles_x;
+} world_rect_job;
+
+void world_rect_tiles(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    world_rect_job* job = ctx;
+    rs_world_params* params = job->params;
+    rs_world_bounds* b = job->bounds;
+    u32 stride = job->map->width;
+    float c[RS_TILE_SIZE * RS_TILE_SIZE];
+    float e[RS_TILE_SIZE * RS_TILE_SIZE];
+
+    for (u32 tile = begin; tile < end; tile++) {
+        u32 x0 = (tile % job->tiles_x) * RS_TILE_SIZE;
+        u32 y0 = (tile / job->tiles_x) * RS_TILE_SIZE;
+        u32 w = stride - x0 < RS_TILE_SIZE ? stride - x0 : RS_TILE_SIZE;
+        u32 h = job->map->height - y0 < RS_TILE_SIZE ? job->map->height - y0 : RS_TILE_SIZE;
+        u32 step = job->step;
+        int wx = job->x0 + (int)(x0 * step);
+        int wy = job->y0 + (int)(y0 * step);
+
+        float* map = &job->map->data[x0 + y0 * stride];
+        layer_fill_rect_lod(map, stride, wx, wy, w, h, step, &params->base, &job->noise.base);
+        layer_fill_rect_lod(c, RS_TILE_SIZE, wx, wy, w, h, step, &params->continentalness, &job->noise.continentalness);
+        layer_fill_rect_lod(e, RS_TILE_SIZE, wx, wy, w, h, step, &params->erosion, &job->noise.erosion);
+
+        float height[RS_TILE_SIZE];
+        float relief[RS_TILE_SIZE];
+        for (u32 y = 0; y < h; y++) {
+            float* cn = &c[y * RS_TILE_SIZE];
+            float* en = &e[y * RS_TILE_SIZE];
+            float* row = &map[y * stride];
+            rs_span_remap(cn, w, b->continentalness_min, b->continentalness_max,
+                          params->continentalness.lo, params->continentalness.hi);
+            rs_span_remap(en, w, b->erosion_min, b->erosion_max,
+                          params->erosion.lo, params->erosion.hi);
+            rs_span_remap(row, w, b->base_min, b->base_max, params->base.lo, params->base.hi);
+            rs_curve_eval_bulk(job->offset_curve, cn, height, w);
+            rs_curve_eval_bulk(job->erosion_curve, en, relief, w);
+
+            for (u32 x = 0; x < w; x++) {
+                row[x] = height[x] + relief[x] * row[x];
+            }
+            rs_span_remap(row, w, b->map_min, b->map_max, params->map_lo, params->map_hi);
+
+            // cells outside the measured region may overshoot
+            for (u32 x = 0; x < w; x++) {
+                if (row[x] < params->map_lo) row[x] = params->map_lo;
+                if (row[x] > params->map_hi) row[x] = params->map_hi;
+            }
+        }
+    }
+}
+
+void rs_build_world_rect(rs_grid* map, int x0, int y0, rs_world_params* params, rs_world_bounds* bounds, rs_pool* pool) {
+    rs_build_world_preview(map, x0, y0, 1, params, bounds, pool);
+}
+
+void rs_build_world_preview(rs_grid* map, int x0, int y0, u32 step, rs_world_params* params, rs_world_bounds* bounds,
+                            rs_pool* pool) {
+    world_rect_job job;
+    job.params = params;
+    world_noise_init(&job.noise, params);
+    job.bounds = bounds;
+    job.map = map;
+    job.offset_curve = make_offset_curve();
+    job.erosion_curve = make_erosion_curve();
+    job.x0 = x0;
+    job.y0 = y0;
+    job.step = step > 0 ? step : 1;
+    job.tiles_x = (map->width + RS_TILE_SIZE - 1) / RS_TILE_SIZE;
+    u32 num_tiles = job.tiles_x * ((map->height + RS_TILE_SIZE - 1) / RS_TILE_SIZE);
+    rs_pool_parallel_for(pool, num_tiles, 1, world_rect_tiles, &job);
+    rs_free_curve(job.offset_curve);
+    rs_free_curve(job.erosion_curve);
+}
+
+rs_terra* rs_build_world(u32 w, u32 h) {
+    rs_world_params params = rs_default_world_params();
+    return rs_build_world_layers(w, h, &params, RS_LAYER_ALL);
+}
+
+// layers of a mapped world point into the mapping
+void free_layer(rs_terra* t, rs_grid* g) {
+    if (g == NULL) return;
+    if (t->mapping != NULL) free(g);
+    else rs_free_grid(g);
+}
+
 void rs_free_terra(rs_terra* t) {
-    rs_free_grid(t->base);
-    rs_free_grid(t->continentalness);
-    rs_free_grid(t->erosion);
-    rs_free_grid(t->map);
+    free_layer(t, t->base);
+    free_layer(t, t->continentalness);
+    free_layer(t, t->erosion);
+    free_layer(t, t->map);
+    if (t->normals != NULL) rs_free_normals(t->normals);
+    if (t->mapping != NULL) rs_unmap_world(t->mapping, t->mapping_bytes);
     free(t);
 }
 
@@ -162,10 +614,10 @@ void rs_grid_fill(rs_grid* g, float value) {
     }
 }
 
-void rs_grid_random_fill(rs_grid* g) {
-    srand(time(NULL));
+void rs_grid_random_fill(rs_grid* g, u64 seed) {
+    rs_rng rng = rs_make_rng(seed, 0);
     for (u32 i = 0; i < g->width * g->height; i++) {
-        g->data[i] = rand() % 5;
+        g->data[i] = rs_rng_below(&rng, 5);
     }
 }
 
@@ -176,16 +628,9 @@ void rs_grid_seq_fill(rs_grid* g) {
 }
 
 void rs_grid_norm(rs_grid* g, float lo, float hi) {
-    float min = FLT_MAX;
-    float max = FLT_MIN;
-    for (u32 i = 0; i < g->size; i++) {
-        float d = g->data[i];
-        if (d > max) max = d;
-        if (d < min) min = d;
-    }
-    for (u32 i = 0; i < g->size; i++) {
-        g->data[i] = rs_remap(g->data[i], min, max, lo, hi);
-    }
+    rs_range r = rs_grid_minmax(g);
+    if (r.min > r.max) return;
+    rs_grid_remap(g, r.min, r.max, lo, hi);
 }
 
 float rs_grid_get(rs_grid* g, u32 x, u32 y) {
@@ -200,13 +645,14 @@ void rs_grid_set(rs_grid* g, u32 x, u32 y, float value) {
     g->data[x + y * g->width] = value;
 }
 
-void diamond_square(float* map, int size, float roughness) {
+void diamond_square(float* map, int size, float roughness, u64 seed) {
+    rs_rng rng = rs_make_rng(seed, 0);
 
     map[index(0, 0, size)]
         = map[index(0, size-1, size)]
         = map[index(size-1, 0, size)]
         = map[index(size-1, size-1, size)]
-        = rand() % 256;
+        = rs_rng_below(&rng, 256);
 
     int step = size - 1;
 
@@ -222,7 +668,7 @@ void diamond_square(float* map, int size, float roughness) {
                              map[index(x, y + step, size)]  + map[index(x + step, y + step, size)]) / 4.0f;
 
                 // Set the midpoint with a random offset
-                map[index(mid_x, mid_y, size)] = avg + rand_range(roughness);
+                map[index(mid_x, mid_y, size)] = avg + rand_range(&rng, roughness);
             }
         }
 
@@ -256,7 +702,7 @@ void diamond_square(float* map, int size, float roughness) {
                 avg /= count;
 
                 // Set the midpoint with a random offset
-                map[index(mid_x, mid_y, size)] = avg + rand_range(roughness);
+                map[index(mid_x, mid_y, size)] = avg + rand_range(&rng, roughness);
             }
         }
 
@@ -274,86 +720,17 @@ void threshold(float map[], int size, float threshold) {
     }
 }
 
+// one-off lighting of a height grid. callers that light the same terrain
+// repeatedly should keep its normals (rs_terra_normals) and call
+// rs_light_normals() instead
 void rs_calculate_lighting(rs_grid* lightmap, rs_grid* world, rs_light* light) {
     if (lightmap->size != world->size) {
         return;
     }
 
-    float z_at_light = rs_grid_get(world, round(light->x), round(light->y));
-
-    if (z_at_light >= light->z) {
-        // light is below surface, set intensity to 0 across the board
-        rs_grid_fill(lightmap, 0.0);
-        return;
-    }
-
-    float min = FLT_MAX;
-    float max = FLT_MIN;
-
-    for (int x = 0; x < (int)world->width; x++) {
-        for(int y = 0; y < (int)world->height; y++) {
-
-            /*
-            float dx = (float)x - (float)light->x;
-            float dy = (float)y - (float)light->y;
-            float dz = (float)z - (float)light->z;
-            float dist_from_light = sqrt((dx*dx) + (dy*dy) + (dz*dz));
-            int value = round(dist_from_light);
-            if (value < min) min = value;
-            if (value > max) max = value;
-            rs_set_griddata(lightmap, x, y, value);
-            */
-            float z = rs_grid_get(world, (u32)x, (u32)y);
-            /*if (z < 110) { z = 110.0; }*/
-
-
-            /*
-            float light_vec_x = (float)x - light->x;
-            float light_vec_y = (float)y - light->y;
-            float light_vec_z = (float)z - light->z;
-            */
-            float light_vec_x = (float)x - 1;
-            float light_vec_y = (float)y - 1;
-            float light_vec_z = (float)z - light->z;
-
-            // normalize light vector
-            float light_vec_len = sqrtf(light_vec_x * light_vec_x + light_vec_y * light_vec_y + light_vec_z * light_vec_z);
-            light_vec_x /= light_vec_len;
-            light_vec_y /= light_vec_len;
-            light_vec_z /= light_vec_len;
-
-            float left_height     = (x > 0)                         ? rs_grid_get(world, (u32)x - 1u, (u32)y     ) : z;
-            float right_height    = (x < (int)lightmap->width - 1)  ? rs_grid_get(world, (u32)x + 1u, (u32)y     ) : z;
-            float top_height      = (y > 0)                         ? rs_grid_get(world, (u32)x     , (u32)y - 1u) : z;
-            float bottom_height   = (y < (int)lightmap->height - 1) ? rs_grid_get(world, (u32)x     , (u32)y + 1u) : z;
-
-            /*
-            if (left_height < 110) left_height = 110;
-            if (right_height < 110) right_height = 110;
-            if (top_height < 110) top_height = 110;
-            if (bottom_height < 110) bottom_height = 110;
-            */
-
-            float norm_x = left_height - right_height;
-            float norm_y = top_height - bottom_height;
-            float norm_z = 2.0f;
-
-            float norm_len = sqrtf(norm_x * norm_x + norm_y * norm_y + norm_z * norm_z);
-            norm_x /= norm_len;
-            norm_y /= norm_len;
-            norm_z /= norm_len;
-
-            float dot_product = light_vec_x * norm_x + light_vec_y * norm_y + light_vec_z * norm_z;
-            
-            float intensity = fmaxf(0.0, -dot_product);
-
-            rs_grid_set(lightmap, x, y, intensity);
-            if (intensity < min) min = intensity;
-            if (intensity > max) max = intensity;
-        }
-    }
-
-    printf("rs_calculate_lighting: min_intensity = %.6f, max_intensity = %.6f, light->z = %.2f\n", min, max, light->z);
+    rs_normals* normals = rs_make_normals(world);
+    rs_light_normals(lightmap, world, normals, light);
+    rs_free_normals(normals);
 }
 
 rs_light* rs_make_light(float x, float y, float z, float intensity) {
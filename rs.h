@@ -1,12 +1,20 @@
 #ifndef RS_H
 #define RS_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <raylib.h>
 
+typedef uint64_t u64;
 typedef uint32_t u32;
+typedef uint16_t u16;
 typedef uint8_t u8;
 
+// see rs_pool.h
+typedef struct rs_pool rs_pool;
+// rs_noise, see rs_perlin.h
+struct rs_noise;
+
 typedef struct {
     float x, y, z;
     float intensity;
@@ -19,13 +27,66 @@ typedef struct {
     float* data;
 } rs_grid;
 
+// unit surface normals of a height grid, x and y packed as snorm16 pairs,
+// z is positive and rebuilt from them. see rs_normals.h
+typedef struct {
+    u32 width;
+    u32 height;
+    int16_t* xy;
+} rs_normals;
+
+// layers left NULL were not kept by rs_build_world_layers(), normals of
+// the map are built on first use by rs_terra_normals(). a world loaded by
+// rs_load_world() has its layer data in a private file mapping
 typedef struct {
     rs_grid* base;
     rs_grid* continentalness;
     rs_grid* erosion;
     rs_grid* map;
+    rs_normals* normals;
+    void* mapping;            // see rs_world_file.h, NULL when malloc'd
+    size_t mapping_bytes;
 } rs_terra;
 
+// noise functions a layer can be built from
+enum {
+    RS_NOISE_PERLIN,          // cnoise2, rs_perlin.h
+    RS_NOISE_SIMPLEX,         // csnoise2, rs_simplex.h
+};
+
+// noise layer settings, normalized to [lo, hi] over the whole world. the
+// seed picks the layer's permutation table, 0 is the reference table, and
+// engine is a RS_NOISE_* value
+typedef struct {
+    float scale;
+    float octaves;
+    float persistence;
+    float lacunarity;
+    float lo, hi;
+    u64 seed;
+    u32 engine;
+} rs_layer_params;
+
+typedef struct {
+    rs_layer_params base;
+    rs_layer_params continentalness;
+    rs_layer_params erosion;
+    float map_lo, map_hi;
+} rs_world_params;
+
+// raw layer bounds and combined map bounds used for normalization
+typedef struct {
+    float base_min, base_max;
+    float continentalness_min, continentalness_max;
+    float erosion_min, erosion_max;
+    float map_min, map_max;
+} rs_world_bounds;
+
+#define RS_LAYER_BASE            (1 << 0)
+#define RS_LAYER_CONTINENTALNESS (1 << 1)
+#define RS_LAYER_EROSION         (1 << 2)
+#define RS_LAYER_ALL             (RS_LAYER_BASE | RS_LAYER_CONTINENTALNESS | RS_LAYER_EROSION)
+
 //
 // utility function
 //
@@ -35,7 +96,49 @@ float rs_remap(float value, float input_min, float input_max, float output_min,
 //
 // terrain functions
 //
+
+// grids are filled in RS_TILE_SIZE square tiles spread over rs_default_pool(),
+// every cell gets the same value as a serial row by row fill
+#define RS_TILE_SIZE (64)
+
+void perlin_fill(rs_grid* g, float scale, float octaves, float persistence, float lacunarity);
+void perlin_fill_ctx(const struct rs_noise* noise, rs_grid* g, float scale, float octaves, float persistence, float lacunarity);
+void perlin_fill_rect(const struct rs_noise* noise, float* dst, u32 stride, int x0, int y0, u32 w, u32 h,
+                      float scale, float octaves, float persistence, float lacunarity);
+// fBm of the RS_NOISE_* engine at every step-th cell from (x0, y0), band
+// limited to footprint noise units between samples when it's over 0
+void noise_fill_rect(u32 engine, const struct rs_noise* noise, float* dst, u32 stride, int x0, int y0, u32 w, u32 h,
+                     u32 step, float footprint, float scale, float octaves, float persistence, float lacunarity);
+// perlin_fill_rect() of every step-th cell from (x0, y0), band limited to
+// what a step cell spacing can resolve, see cnoise2_filtered()
+void perlin_fill_rect_lod(const struct rs_noise* noise, float* dst, u32 stride, int x0, int y0, u32 w, u32 h, u32 step,
+                          float scale, float octaves, float persistence, float lacunarity);
+// the noise of perlin_fill_ctx() in g and its analytic slope per cell in sx
+// and sy, from the same evaluation
+void perlin_fill_slopes(const struct rs_noise* noise, rs_grid* g, rs_grid* sx, rs_grid* sy,
+                        float scale, float octaves, float persistence, float lacunarity);
+void perlin_fill_rect_deriv(const struct rs_noise* noise, float* dst, float* sx, float* sy, u32 stride, int x0, int y0, u32 w, u32 h,
+                            float scale, float octaves, float persistence, float lacunarity);
+
+rs_world_params rs_default_world_params();
 rs_terra* rs_build_world(u32 width, u32 height);
+// builds the map in fused tile passes, only the intermediate layers named
+// in keep (RS_LAYER_* flags) are allocated and returned, normalized
+rs_terra* rs_build_world_layers(u32 width, u32 height, rs_world_params* params, u32 keep);
+void rs_free_terra(rs_terra* t);
+
+// bounds of a width x height world at the origin
+rs_world_bounds rs_measure_world_bounds(rs_world_params* params, u32 width, u32 height);
+// fills map with the world at cell (x0, y0) normalized by fixed bounds and
+// clamped to [map_lo, map_hi], spread over pool. the result is independent
+// of the rect
+void rs_build_world_rect(rs_grid* map, int x0, int y0, rs_world_params* params, rs_world_bounds* bounds, rs_pool* pool);
+// rs_build_world_rect() with map cell (x, y) at world cell
+// (x0 + x * step, y0 + y * step), for overviews and zoomed out previews.
+// octaves finer than step cells are faded out instead of evaluated and
+// aliased, step 1 is rs_build_world_rect()
+void rs_build_world_preview(rs_grid* map, int x0, int y0, u32 step, rs_world_params* params, rs_world_bounds* bounds,
+                            rs_pool* pool);
 
 
 //
@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include "rs_budget.h"
+
+static const rs_quality quality_levels[] = {
+    { 1.00f, 1, 1.00f },
+    { 0.75f, 1, 0.75f },
+    { 0.50f, 1, 0.50f },
+    { 0.50f, 2, 0.25f },
+    { 0.25f, 4, 0.10f },
+    { 0.25f, 8, 0.00f },
+};
+
+#define NUM_LEVELS ((int)(sizeof(quality_levels) / sizeof(quality_levels[0])))
+
+rs_budget* rs_make_budget(float budget_ms) {
+    rs_budget* b = malloc(sizeof(rs_budget));
+    b->budget_ms = budget_ms;
+    b->frame_ms = 0;
+    b->smoothing = 0.1f;
+    b->high_water = 1.0f;
+    b->low_water = 0.6f;
+    b->drop_frames = 10;
+    b->raise_frames = 90;
+    b->cooldown_frames = 30;
+    b->over = 0;
+    b->under = 0;
+    b->cooldown = 0;
+    b->level = 0;
+    b->enabled = 1;
+    return b;
+}
+
+void rs_free_budget(rs_budget* b) {
+    free(b);
+}
+
+int rs_budget_update(rs_budget* b, float frame_ms) {
+    if (b->frame_ms <= 0) {
+        b->frame_ms = frame_ms;
+    }
+    else {
+        b->frame_ms += b->smoothing * (frame_ms - b->frame_ms);
+    }
+
+    if (!b->enabled) {
+        int changed = b->level != 0;
+        b->level = 0;
+        b->over = b->under = b->cooldown = 0;
+        return changed;
+    }
+
+    if (b->cooldown > 0) {
+        b->cooldown--;
+        return 0;
+    }
+
+    if (b->frame_ms > b->budget_ms * b->high_water) {
+        b->over++;
+        b->under = 0;
+    }
+    else if (b->frame_ms < b->budget_ms * b->low_water) {
+        b->under++;
+        b->over = 0;
+    }
+    else {
+        b->over = 0;
+        b->under = 0;
+    }
+
+    int level = b->level;
+    if (b->over >= b->drop_frames && level < NUM_LEVELS - 1) {
+        level++;
+    }
+    else if (b->under >= b->raise_frames && level > 0) {
+        level--;
+    }
+
+    if (level == b->level) {
+        return 0;
+    }
+
+    b->level = level;
+    b->over = 0;
+    b->under = 0;
+    b->cooldown = b->cooldown_frames;
+    return 1;
+}
+
+rs_quality rs_budget_quality(rs_budget* b) {
+    return quality_levels[b->level];
+}
+
+int rs_budget_levels() {
+    return NUM_LEVELS;
+}
@@ -0,0 +1,42 @@
+#ifndef RS_BUDGET_H
+#define RS_BUDGET_H
+
+//
+// frame time budget controller. it steps through a fixed ladder of quality
+// levels, dropping one level while frames run over budget and raising one
+// while there is plenty of headroom. the two thresholds are far apart and
+// each change is followed by a cooldown, so it settles instead of bouncing
+// between neighbouring levels.
+//
+
+typedef struct {
+    float field_scale;       // field render resolution relative to the window
+    int particle_stride;     // draw every n-th particle
+    float replication_scale; // multiplier on the replication rate
+} rs_quality;
+
+typedef struct {
+    float budget_ms;
+    float frame_ms;          // smoothed frame time
+    float smoothing;         // weight of the newest sample in frame_ms
+    float high_water;        // drop a level above budget_ms * high_water
+    float low_water;         // raise a level below budget_ms * low_water
+    int drop_frames;         // frames over budget before dropping a level
+    int raise_frames;        // frames of headroom before raising a level
+    int cooldown_frames;     // frames ignored after any change
+    int over;
+    int under;
+    int cooldown;
+    int level;               // 0 is full quality
+    int enabled;
+} rs_budget;
+
+rs_budget* rs_make_budget(float budget_ms);
+void rs_free_budget(rs_budget* b);
+
+// feeds the cost of the last frame, returns 1 when the level changed
+int rs_budget_update(rs_budget* b, float frame_ms);
+rs_quality rs_budget_quality(rs_budget* b);
+int rs_budget_levels();
+
+#endif
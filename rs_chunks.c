@@ -0,0 +1,205 @@
+#include <stdlib.h>
+#include <math.h>
+#include "rs_chunks.h"
+#include "rs_rand.h"
+#include "rs_pool.h"
+
+#define MIN_BUCKETS (64)
+
+rs_chunks* rs_make_chunks(rs_world_params* params, u32 chunk_size, size_t budget_bytes) {
+    rs_chunks* c = calloc(1, sizeof(rs_chunks));
+    c->params = *params;
+    c->bounds = rs_measure_world_bounds(&c->params, RS_CHUNK_REFERENCE_SIZE, RS_CHUNK_REFERENCE_SIZE);
+    c->chunk_size = chunk_size;
+    c->chunk_bytes = sizeof(rs_chunk) + sizeof(rs_grid) + (size_t)chunk_size * chunk_size * sizeof(float);
+    c->budget_bytes = budget_bytes;
+    c->num_buckets = MIN_BUCKETS;
+    c->buckets = calloc(c->num_buckets, sizeof(rs_chunk*));
+    return c;
+}
+
+void rs_free_chunks(rs_chunks* c) {
+    rs_chunk* k = c->newest;
+    while (k != NULL) {
+        rs_chunk* older = k->older;
+        rs_free_grid(k->map);
+        free(k);
+        k = older;
+    }
+    free(c->buckets);
+    free(c);
+}
+
+int rs_chunk_coord(rs_chunks* c, int cell) {
+    int size = (int)c->chunk_size;
+    return cell >= 0 ? cell / size : -((-cell + size - 1) / size);
+}
+
+static u32 bucket_of(rs_chunks* c, int cx, int cy) {
+    u64 key = ((u64)(u32)cx << 32) | (u32)cy;
+    return (u32)rs_hash64(key) & (c->num_buckets - 1);
+}
+
+rs_chunk* rs_chunks_find(rs_chunks* c, int cx, int cy) {
+    rs_chunk* k = c->buckets[bucket_of(c, cx, cy)];
+    while (k != NULL && (k->cx != cx || k->cy != cy)) {
+        k = k->next;
+    }
+    return k;
+}
+
+static void lru_unlink(rs_chunks* c, rs_chunk* k) {
+    if (k->newer != NULL) k->newer->older = k->older;
+    else c->newest = k->older;
+    if (k->older != NULL) k->older->newer = k->newer;
+    else c->oldest = k->newer;
+    k->newer = k->older = NULL;
+}
+
+static void lru_push(rs_chunks* c, rs_chunk* k) {
+    k->older = c->newest;
+    k->newer = NULL;
+    if (c->newest != NULL) c->newest->newer = k;
+    c->newest = k;
+    if (c->oldest == NULL) c->oldest = k;
+}
+
+static void rehash(rs_chunks* c, u32 num_buckets) {
+    rs_chunk** old = c->buckets;
+    u32 old_n = c->num_buckets;
+    c->buckets = calloc(num_buckets, sizeof(rs_chunk*));
+    c->num_buckets = num_buckets;
+    for (u32 i = 0; i < old_n; i++) {
+        rs_chunk* k = old[i];
+        while (k != NULL) {
+            rs_chunk* next = k->next;
+            u32 b = bucket_of(c, k->cx, k->cy);
+            k->next = c->buckets[b];
+            c->buckets[b] = k;
+            k = next;
+        }
+    }
+    free(old);
+}
+
+static void evict(rs_chunks* c, rs_chunk* k) {
+    rs_chunk** link = &c->buckets[bucket_of(c, k->cx, k->cy)];
+    while (*link != k) {
+        link = &(*link)->next;
+    }
+    *link = k->next;
+    lru_unlink(c, k);
+    rs_free_grid(k->map);
+    free(k);
+    c->count--;
+    c->bytes -= c->chunk_bytes;
+}
+
+// drops least recently used chunks until there is room for one more,
+// stopping at the first chunk the current update still needs
+static void make_room(rs_chunks* c) {
+    while (c->oldest != NULL && c->bytes + c->chunk_bytes > c->budget_bytes) {
+        if (c->updating && c->oldest->stamp == c->stamp) break;
+        evict(c, c->oldest);
+    }
+}
+
+static void touch(rs_chunks* c, rs_chunk* k) {
+    lru_unlink(c, k);
+    lru_push(c, k);
+    k->stamp = c->stamp;
+}
+
+rs_chunk* rs_chunks_insert(rs_chunks* c, int cx, int cy, rs_grid* map) {
+    rs_chunk* k = rs_chunks_find(c, cx, cy);
+    if (k != NULL) {
+        rs_free_grid(map);
+        touch(c, k);
+        return k;
+    }
+
+    make_room(c);
+
+    k = calloc(1, sizeof(rs_chunk));
+    k->cx = cx;
+    k->cy = cy;
+    k->stamp = c->stamp;
+    k->map = map;
+
+    if (c->count >= c->num_buckets) {
+        rehash(c, c->num_buckets * 2);
+    }
+    u32 b = bucket_of(c, cx, cy);
+    k->next = c->buckets[b];
+    c->buckets[b] = k;
+    lru_push(c, k);
+    c->count++;
+    c->bytes += c->chunk_bytes;
+    return k;
+}
+
+rs_grid* rs_chunks_generate(rs_chunks* c, int cx, int cy, rs_pool* pool) {
+    rs_grid* map = rs_make_grid(c->chunk_size, c->chunk_size);
+    rs_build_world_rect(map, cx * (int)c->chunk_size, cy * (int)c->chunk_size, &c->params, &c->bounds, pool);
+    return map;
+}
+
+rs_chunk* rs_chunks_get(rs_chunks* c, int cx, int cy) {
+    rs_chunk* k = rs_chunks_find(c, cx, cy);
+    if (k != NULL) {
+        touch(c, k);
+        return k;
+    }
+    return rs_chunks_insert(c, cx, cy, rs_chunks_generate(c, cx, cy, rs_default_pool()));
+}
+
+static int compare_requests(const void* a, const void* b) {
+    float da = ((const rs_chunk_request*)a)->d2;
+    float db = ((const rs_chunk_request*)b)->d2;
+    return (da > db) - (da < db);
+}
+
+u32 rs_chunks_requests(rs_chunks* c, float x, float y, float radius, rs_chunk_request** out) {
+    float size = (float)c->chunk_size;
+    int cx0 = rs_chunk_coord(c, (int)floorf(x - radius));
+    int cx1 = rs_chunk_coord(c, (int)floorf(x + radius));
+    int cy0 = rs_chunk_coord(c, (int)floorf(y - radius));
+    int cy1 = rs_chunk_coord(c, (int)floorf(y + radius));
+
+    u32 n = 0;
+    rs_chunk_request* requests = malloc((size_t)(cx1 - cx0 + 1) * (cy1 - cy0 + 1) * sizeof(rs_chunk_request));
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            // distance from (x, y) to the nearest point of the chunk
+            float dx = fmaxf(fmaxf(cx * size - x, x - (cx + 1) * size), 0);
+            float dy = fmaxf(fmaxf(cy * size - y, y - (cy + 1) * size), 0);
+            float d2 = dx * dx + dy * dy;
+            if (d2 <= radius * radius) {
+                requests[n++] = (rs_chunk_request) { cx, cy, d2 };
+            }
+        }
+    }
+    qsort(requests, n, sizeof(rs_chunk_request), compare_requests);
+    *out = requests;
+    return n;
+}
+
+void rs_chunks_update(rs_chunks* c, float x, float y, float radius) {
+    rs_chunk_request* requests;
+    u32 n = rs_chunks_requests(c, x, y, radius, &requests);
+
+    c->stamp++;
+    c->updating = 1;
+    for (u32 i = 0; i < n; i++) {
+        rs_chunks_get(c, requests[i].cx, requests[i].cy);
+    }
+    c->updating = 0;
+    free(requests);
+}
+
+float rs_chunks_height(rs_chunks* c, int x, int y) {
+    int cx = rs_chunk_coord(c, x);
+    int cy = rs_chunk_coord(c, y);
+    rs_chunk* k = rs_chunks_get(c, cx, cy);
+    return rs_grid_get(k->map, (u32)(x - cx * (int)c->chunk_size), (u32)(y - cy * (int)c->chunk_size));
+}
@@ -0,0 +1,74 @@
+#ifndef RS_CHUNKS_H
+#define RS_CHUNKS_H
+
+#include <stddef.h>
+#include "rs.h"
+
+#define RS_CHUNK_SIZE           (256)
+// side of the region at the origin the normalization bounds are measured on
+#define RS_CHUNK_REFERENCE_SIZE (2048)
+
+//
+// unbounded terrain generated in square chunks on demand. every chunk is
+// normalized with the same bounds, measured once from a reference region,
+// so a chunk only depends on its coordinates and neighbours line up
+// exactly. chunks are kept in a hash map and an lru list; once the cache
+// goes over its memory budget the least recently used chunks are dropped,
+// which are the ones the camera left behind.
+//
+typedef struct rs_chunk {
+    int cx, cy;
+    u32 stamp;                // rs_chunks stamp of the last update that used it
+    rs_grid* map;
+    struct rs_chunk* next;    // hash chain
+    struct rs_chunk* newer;   // lru list
+    struct rs_chunk* older;
+} rs_chunk;
+
+typedef struct {
+    rs_world_params params;
+    rs_world_bounds bounds;
+    u32 chunk_size;
+    size_t chunk_bytes;
+    size_t budget_bytes;
+    size_t bytes;
+    u32 count;
+    u32 num_buckets;
+    rs_chunk** buckets;
+    rs_chunk* newest;
+    rs_chunk* oldest;
+    u32 stamp;
+    int updating;
+} rs_chunks;
+
+typedef struct {
+    int cx, cy;
+    float d2;                 // squared distance to the nearest point of the chunk
+} rs_chunk_request;
+
+rs_chunks* rs_make_chunks(rs_world_params* params, u32 chunk_size, size_t budget_bytes);
+void rs_free_chunks(rs_chunks* c);
+
+// chunk coordinate of a world cell coordinate
+int rs_chunk_coord(rs_chunks* c, int cell);
+
+// cached chunk or NULL, doesn't touch the lru order
+rs_chunk* rs_chunks_find(rs_chunks* c, int cx, int cy);
+// cached or freshly generated chunk. may evict other chunks, so pointers
+// from earlier calls are only good until the next get or update
+rs_chunk* rs_chunks_get(rs_chunks* c, int cx, int cy);
+// chunks within radius cells of (x, y) nearest first, *out is malloc'd
+u32 rs_chunks_requests(rs_chunks* c, float x, float y, float radius, rs_chunk_request** out);
+// builds the map of a chunk without caching it, safe to call from any
+// thread
+rs_grid* rs_chunks_generate(rs_chunks* c, int cx, int cy, rs_pool* pool);
+// caches a generated map, taking ownership of it
+rs_chunk* rs_chunks_insert(rs_chunks* c, int cx, int cy, rs_grid* map);
+// makes sure every chunk within radius cells of (x, y) is cached, nearest
+// first. chunks used by this update are never evicted by it, even when
+// they alone go over budget
+void rs_chunks_update(rs_chunks* c, float x, float y, float radius);
+// map height at a world cell, generating its chunk when needed
+float rs_chunks_height(rs_chunks* c, int x, int y);
+
+#endif
@@ -0,0 +1,184 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <immintrin.h>
+#include "rs_colorize.h"
+#include "rs_pool.h"
+
+#define AVX2 __attribute__((target("avx2")))
+
+#define COLORIZE_GRAIN (1 << 16)
+#define WATER_GRAIN (1 << 14)
+
+static int has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static void fill_band(rs_palette* p, float above, float up_to, Color color) {
+    for (u32 k = 0; k < p->num_bins; k++) {
+        float top = p->lo + k * p->step;
+        if (top > above && top <= up_to) p->colors[k] = color;
+    }
+}
+
+rs_palette* rs_make_world_palette() {
+    rs_palette* p = malloc(sizeof(rs_palette));
+    p->lo = RS_PALETTE_LO;
+    p->step = RS_PALETTE_STEP;
+    p->num_bins = (u32)((RS_PALETTE_HI - RS_PALETTE_LO) / RS_PALETTE_STEP) + 2;
+    p->colors = malloc(p->num_bins * sizeof(Color));
+
+    Color lo_land_color  = { 20, 200, 130, 255 };
+    Color hi_land_color  = { 200, 200, 50, 255 };
+    Color ice_land_color = { 200, 200, 200, 255 };
+
+    // bin 0 is the water, painted per frame
+    p->colors[0] = (Color) { 0, 0, 0, 255 };
+    fill_band(p, RS_WATER_LEVEL, 110, BLUE);
+    fill_band(p, 110, 135, lo_land_color);
+    fill_band(p, 135, 140, hi_land_color);
+    fill_band(p, 140, INFINITY, ice_land_color);
+    // the last bin also takes everything over RS_PALETTE_HI
+    p->colors[p->num_bins - 1] = ice_land_color;
+    return p;
+}
+
+void rs_free_palette(rs_palette* p) {
+    free(p->colors);
+    free(p);
+}
+
+rs_colorizer* rs_make_colorizer(rs_grid* world) {
+    rs_colorizer* c = calloc(1, sizeof(rs_colorizer));
+    c->world = world;
+    c->palette = rs_make_world_palette();
+    c->pixels = malloc(world->size * sizeof(Color));
+    return c;
+}
+
+void rs_free_colorizer(rs_colorizer* c) {
+    rs_free_palette(c->palette);
+    free(c->water);
+    free(c->pixels);
+    free(c);
+}
+
+//
+// full repaint
+//
+
+// heights at or below lo land in bin 0, NaN in the last bin like the
+// fall through of calc_world_color()
+static u32 bin_of(rs_palette* p, float v) {
+    float t = ceilf((v - p->lo) * (1.0f / p->step));
+    float last = (float)(p->num_bins - 1);
+    t = t < last ? t : last;
+    t = t > 0 ? t : 0;
+    return (u32)t;
+}
+
+// also counts the water cells
+AVX2 static u32 colorize_avx2(rs_palette* p, const float* v, Color* out, u32 n, u32* water) {
+    __m256 lo = _mm256_set1_ps(p->lo);
+    __m256 inv_step = _mm256_set1_ps(1.0f / p->step);
+    __m256 last = _mm256_set1_ps((float)(p->num_bins - 1));
+    __m256 zero = _mm256_setzero_ps();
+    __m256 level = _mm256_set1_ps(RS_WATER_LEVEL);
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(v + i);
+        *water += __builtin_popcount(_mm256_movemask_ps(_mm256_cmp_ps(x, level, _CMP_LE_OQ)));
+        __m256 t = _mm256_ceil_ps(_mm256_mul_ps(_mm256_sub_ps(x, lo), inv_step));
+        // min returns its second operand for NaN
+        t = _mm256_max_ps(_mm256_min_ps(t, last), zero);
+        __m256i bins = _mm256_cvttps_epi32(t);
+        __m256i rgba = _mm256_i32gather_epi32((const int*)p->colors, bins, 4);
+        _mm256_storeu_si256((__m256i*)(out + i), rgba);
+    }
+    return i;
+}
+
+typedef struct {
+    rs_colorizer* c;
+    u32* counts;              // water cells per chunk
+    u32* offsets;
+    u32 frame_num;
+} colorize_job;
+
+static void colorize_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    colorize_job* job = ctx;
+    rs_palette* p = job->c->palette;
+    float* v = job->c->world->data;
+    Color* out = job->c->pixels;
+
+    u32 count = 0;
+    u32 i = has_avx2() ? begin + colorize_avx2(p, v + begin, out + begin, end - begin, &count) : begin;
+    for (; i < end; i++) {
+        out[i] = p->colors[bin_of(p, v[i])];
+        count += v[i] <= RS_WATER_LEVEL;
+    }
+    job->counts[begin / COLORIZE_GRAIN] = count;
+}
+
+static void water_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    colorize_job* job = ctx;
+    if (job->counts[begin / COLORIZE_GRAIN] == 0) return;
+    float* v = job->c->world->data;
+    u32* water = &job->c->water[job->offsets[begin / COLORIZE_GRAIN]];
+    for (u32 i = begin; i < end; i++) {
+        if (v[i] <= RS_WATER_LEVEL) *water++ = i;
+    }
+}
+
+void rs_colorize(rs_colorizer* c, u32 frame_num) {
+    rs_pool* pool = rs_default_pool();
+    u32 size = c->world->size;
+    u32 num_chunks = (size + COLORIZE_GRAIN - 1) / COLORIZE_GRAIN;
+
+    colorize_job job = { c, NULL, NULL, frame_num };
+    job.counts = malloc((num_chunks + 1) * sizeof(u32));
+    job.offsets = malloc((num_chunks + 1) * sizeof(u32));
+    rs_pool_parallel_for(pool, size, COLORIZE_GRAIN, colorize_chunks, &job);
+
+    u32 total = 0;
+    for (u32 i = 0; i < num_chunks; i++) {
+        job.offsets[i] = total;
+        total += job.counts[i];
+    }
+    c->water = realloc(c->water, (total > 0 ? total : 1) * sizeof(u32));
+    c->num_water = total;
+    if (total > 0) {
+        rs_pool_parallel_for(pool, size, COLORIZE_GRAIN, water_chunks, &job);
+    }
+
+    free(job.counts);
+    free(job.offsets);
+    rs_colorize_water(c, frame_num);
+}
+
+//
+// water animation, the blue channel cycles with cell index and frame
+//
+
+static void animate_water(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    colorize_job* job = ctx;
+    u32* water = job->c->water;
+    Color* out = job->c->pixels;
+    for (u32 i = begin; i < end; i++) {
+        u32 cell = water[i];
+        out[cell] = (Color) { 0, 0, (u8)((cell + job->frame_num) % 128), 255 };
+    }
+}
+
+void rs_colorize_water(rs_colorizer* c, u32 frame_num) {
+    colorize_job job = { c, NULL, NULL, frame_num };
+    rs_pool_parallel_for(rs_default_pool(), c->num_water, WATER_GRAIN, animate_water, &job);
+}
+
+void rs_colorize_texture(rs_colorizer* c, Texture2D texture) {
+    UpdateTexture(texture, c->pixels);
+}
@@ -0,0 +1,48 @@
+#ifndef RS_COLORIZE_H
+#define RS_COLORIZE_H
+
+#include "rs.h"
+
+//
+// bulk version of calc_world_color(). heights are binned into a palette of
+// RS_PALETTE_STEP wide bins over [RS_PALETTE_LO, RS_PALETTE_HI], the band
+// thresholds of calc_world_color() fall on bin edges so every cell gets
+// the same color. cells at or below the water level animate, their indices
+// are kept so a frame only repaints them.
+//
+
+#define RS_PALETTE_LO     (100.0f)
+#define RS_PALETTE_HI     (200.0f)
+#define RS_PALETTE_STEP   (0.25f)
+#define RS_WATER_LEVEL    (100.0f)
+
+typedef struct {
+    float lo;
+    float step;
+    u32 num_bins;             // bin k holds heights in (lo + (k-1) * step, lo + k * step]
+    Color* colors;
+} rs_palette;
+
+typedef struct {
+    rs_grid* world;           // not owned
+    rs_palette* palette;
+    u32* water;               // cells at or below RS_WATER_LEVEL, ascending
+    u32 num_water;
+    Color* pixels;            // world->width * world->height, row-major
+} rs_colorizer;
+
+// the bands of calc_world_color()
+rs_palette* rs_make_world_palette();
+void rs_free_palette(rs_palette* p);
+
+rs_colorizer* rs_make_colorizer(rs_grid* world);
+void rs_free_colorizer(rs_colorizer* c);
+
+// repaints every cell and rebuilds the water list, after the heights changed
+void rs_colorize(rs_colorizer* c, u32 frame_num);
+// repaints only the water for a new frame
+void rs_colorize_water(rs_colorizer* c, u32 frame_num);
+// uploads the pixels to a texture of the world's size
+void rs_colorize_texture(rs_colorizer* c, Texture2D texture);
+
+#endif
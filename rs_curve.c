@@ -0,0 +1,191 @@
+// The pieces follow linterp(): with breakpoints fx[0..n-1], x up to fx[1]
+// gives fy[0], x past fx[n-2] gives fy[n-1] and in between (fx[k], fx[k+1]]
+// interpolates fy[k]..fy[k+1]. The flat pieces are stored as x0 = 0,
+// dx = 1, dy = 0 so every piece goes through the same expression, x is
+// clamped to finite values first so that stays exact (NaN goes to the
+// first piece, as in linterp).
+//
+// The AVX2 path is picked at run time and does the same float operations
+// as the scalar one.
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <immintrin.h>
+#include "rs_curve.h"
+#include "rs_pool.h"
+
+#define AVX2 __attribute__((target("avx2")))
+#define MAX_BINS (1 << 20)
+#define GRID_GRAIN (16384)
+
+static u32 bin_of(rs_curve* c, float x) {
+    float t = (x - c->lo) * c->inv;
+    t = t > 0 ? t : 0;
+    t = t < c->num_bins - 1 ? t : c->num_bins - 1;
+    return (u32)t;
+}
+
+// bins every edge with the current size, returns 0 when two different
+// edges share a bin
+static int fill_bins(rs_curve* c, float* edges, u32 m) {
+    for (u32 b = 0; b < c->num_bins; b++) {
+        c->piece[b] = 0;
+        c->step[b] = 0;
+        c->split[b] = FLT_MAX;
+    }
+    for (u32 k = 0; k < m; k++) {
+        u32 b = bin_of(c, edges[k]);
+        if (c->step[b] > 0 && c->split[b] != edges[k]) return 0;
+        c->split[b] = edges[k];
+        c->step[b]++;
+    }
+    // pieces passed by every x of a bin
+    int below = 0;
+    for (u32 b = 0; b < c->num_bins; b++) {
+        c->piece[b] = below;
+        below += c->step[b];
+    }
+    return 1;
+}
+
+rs_curve* rs_make_curve(float* fx, float* fy, int n, u32 lut_size) {
+    rs_curve* c = calloc(1, sizeof(rs_curve));
+    c->n = n;
+    c->fx = malloc(n * sizeof(float));
+    c->fy = malloc(n * sizeof(float));
+    memcpy(c->fx, fx, n * sizeof(float));
+    memcpy(c->fy, fy, n * sizeof(float));
+
+    // edges between pieces are fx[1..n-2], just fx[1] for two breakpoints
+    u32 m = n >= 3 ? n - 2 : n - 1;
+    float* edges = &c->fx[1];
+
+    c->num_pieces = m + 1;
+    c->x0 = malloc(c->num_pieces * sizeof(float));
+    c->dx = malloc(c->num_pieces * sizeof(float));
+    c->y0 = malloc(c->num_pieces * sizeof(float));
+    c->dy = malloc(c->num_pieces * sizeof(float));
+    for (u32 k = 0; k < c->num_pieces; k++) {
+        if (k == 0 || k == m) {
+            c->x0[k] = 0;
+            c->dx[k] = 1;
+            c->y0[k] = k == 0 ? fy[0] : fy[n-1];
+            c->dy[k] = 0;
+        }
+        else {
+            c->x0[k] = fx[k];
+            c->dx[k] = fx[k+1] - fx[k];
+            c->y0[k] = fy[k];
+            c->dy[k] = fy[k+1] - fy[k];
+        }
+    }
+
+    u32 bins = lut_size > 0 ? lut_size : 1;
+    float span = m > 0 ? edges[m-1] - edges[0] : 0;
+    c->lo = m > 0 ? edges[0] : 0;
+    for (;;) {
+        c->num_bins = bins;
+        c->inv = span > 0 ? bins / span : 0;
+        c->piece = realloc(c->piece, bins * sizeof(int));
+        c->step = realloc(c->step, bins * sizeof(int));
+        c->split = realloc(c->split, bins * sizeof(float));
+        if (fill_bins(c, edges, m)) break;
+        if (bins >= MAX_BINS) {
+            c->num_bins = 0;
+            break;
+        }
+        bins *= 2;
+    }
+    return c;
+}
+
+void rs_free_curve(rs_curve* c) {
+    free(c->fx);
+    free(c->fy);
+    free(c->x0);
+    free(c->dx);
+    free(c->y0);
+    free(c->dy);
+    free(c->piece);
+    free(c->step);
+    free(c->split);
+    free(c);
+}
+
+float rs_curve_eval(rs_curve* c, float x) {
+    if (c->num_bins == 0) return linterp(x, c->fx, c->fy, c->n);
+
+    x = x > -FLT_MAX ? x : -FLT_MAX;
+    x = x < FLT_MAX ? x : FLT_MAX;
+    u32 b = bin_of(c, x);
+    int k = c->piece[b] + (x > c->split[b] ? c->step[b] : 0);
+    float r = (x - c->x0[k]) / c->dx[k];
+    return c->y0[k] + r * c->dy[k];
+}
+
+AVX2 static u32 eval_bulk_avx2(rs_curve* c, const float* x, float* out, u32 n) {
+    __m256 lo = _mm256_set1_ps(c->lo);
+    __m256 inv = _mm256_set1_ps(c->inv);
+    __m256 last_bin = _mm256_set1_ps((float)(c->num_bins - 1));
+    __m256 lowest = _mm256_set1_ps(-FLT_MAX);
+    __m256 highest = _mm256_set1_ps(FLT_MAX);
+    __m256 zero = _mm256_setzero_ps();
+
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) {
+        // max returns its second operand for NaN
+        __m256 v = _mm256_max_ps(_mm256_loadu_ps(x + i), lowest);
+        v = _mm256_min_ps(v, highest);
+
+        __m256 t = _mm256_mul_ps(_mm256_sub_ps(v, lo), inv);
+        t = _mm256_min_ps(_mm256_max_ps(t, zero), last_bin);
+        __m256i b = _mm256_cvttps_epi32(t);
+
+        __m256i piece = _mm256_i32gather_epi32(c->piece, b, 4);
+        __m256i step = _mm256_i32gather_epi32(c->step, b, 4);
+        __m256 split = _mm256_i32gather_ps(c->split, b, 4);
+        __m256i past = _mm256_castps_si256(_mm256_cmp_ps(v, split, _CMP_GT_OQ));
+        __m256i k = _mm256_add_epi32(piece, _mm256_and_si256(past, step));
+
+        __m256 x0 = _mm256_i32gather_ps(c->x0, k, 4);
+        __m256 dx = _mm256_i32gather_ps(c->dx, k, 4);
+        __m256 y0 = _mm256_i32gather_ps(c->y0, k, 4);
+        __m256 dy = _mm256_i32gather_ps(c->dy, k, 4);
+        __m256 r = _mm256_div_ps(_mm256_sub_ps(v, x0), dx);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(y0, _mm256_mul_ps(r, dy)));
+    }
+    return i;
+}
+
+static int has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+void rs_curve_eval_bulk(rs_curve* c, const float* x, float* out, u32 n) {
+    u32 i = 0;
+    if (c->num_bins > 0 && has_avx2()) {
+        i = eval_bulk_avx2(c, x, out, n);
+    }
+    for (; i < n; i++) {
+        out[i] = rs_curve_eval(c, x[i]);
+    }
+}
+
+typedef struct {
+    rs_curve* c;
+    float* src;
+    float* dst;
+} eval_grid_job;
+
+static void eval_grid_range(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    eval_grid_job* job = ctx;
+    rs_curve_eval_bulk(job->c, job->src + begin, job->dst + begin, end - begin);
+}
+
+void rs_curve_eval_grid(rs_curve* c, rs_grid* src, rs_grid* dst) {
+    eval_grid_job job = { c, src->data, dst->data };
+    rs_pool_parallel_for(rs_default_pool(), src->size, GRID_GRAIN, eval_grid_range, &job);
+}
@@ -0,0 +1,46 @@
+#ifndef RS_CURVE_H
+#define RS_CURVE_H
+
+#include "rs.h"
+
+#define RS_CURVE_LUT_SIZE (1024)
+
+//
+// piecewise linear curve given by breakpoints, like the fx/fy arrays passed
+// to linterp(), with the same results bit for bit (including linterp's
+// flat first and last pieces). the breakpoints are baked into a uniform
+// table of bins so evaluating is a multiply, a table read and one compare
+// instead of a binary search. the table doubles from lut_size until no bin
+// holds two different breakpoints.
+//
+typedef struct {
+    int n;
+    float* fx;
+    float* fy;
+
+    // pieces, evaluated as y0 + ((x - x0) / dx) * dy
+    u32 num_pieces;
+    float* x0;
+    float* dx;
+    float* y0;
+    float* dy;
+
+    // bins over [lo, lo + num_bins / inv]. x in bin b is on piece
+    // piece[b], or piece[b] + step[b] when x > split[b]
+    u32 num_bins;            // 0 when the breakpoints couldn't be separated
+    float lo;
+    float inv;
+    int* piece;
+    int* step;
+    float* split;
+} rs_curve;
+
+rs_curve* rs_make_curve(float* fx, float* fy, int n, u32 lut_size);
+void rs_free_curve(rs_curve* c);
+
+float rs_curve_eval(rs_curve* c, float x);
+void rs_curve_eval_bulk(rs_curve* c, const float* x, float* out, u32 n);
+// dst may be src
+void rs_curve_eval_grid(rs_curve* c, rs_grid* src, rs_grid* dst);
+
+#endif
@@ -0,0 +1,213 @@
+#include <stdlib.h>
+#include <math.h>
+#include "rs_horizon.h"
+#include "rs_pool.h"
+
+#define HALF_PI (1.57079632679f)
+#define TWO_PI (6.28318530718f)
+#define LINE_GRAIN (8)
+#define SHADE_ROWS (16)
+
+//
+// sweeping. for an azimuth mostly along x the lines step one column at a
+// time and move round(slope * step) rows, so for every column the lines
+// starting at consecutive rows hit consecutive rows and each cell lies on
+// exactly one line. mostly-y azimuths swap the roles of x and y.
+//
+
+typedef struct {
+    rs_grid* world;
+    rs_horizon* h;
+    u8* plane;
+    int along_x;              // lines step along x
+    int step;                 // +1 or -1 along the major axis, towards the horizon looked for
+    float slope;              // minor axis movement per major step
+    float spacing;            // distance between samples along a line
+    int first_line;
+    u32 length;               // samples per line, the major axis size
+    float* hull_t;            // per worker hull stacks
+    float* hull_z;
+} sweep_job;
+
+// angle code of a slope, atan by a minimax polynomial on [0, 1] (error
+// around 1e-5 radians, far below the 6e-3 of a code step) mirrored for
+// slopes over 1
+static u32 quantize(float slope) {
+    if (slope <= 0) return 0;
+    int steep = slope > 1;
+    float x = steep ? 1 / slope : slope;
+    float x2 = x * x;
+    float a = x * (0.99997726f + x2 * (-0.33262347f + x2 * (0.19354346f + x2 * (-0.11643287f
+                 + x2 * (0.05265332f + x2 * -0.01172120f)))));
+    if (steep) a = HALF_PI - a;
+    return (u32)(a * (255.0f / HALF_PI) + 0.5f);
+}
+
+static void sweep_lines(void* ctx, u32 begin, u32 end, u32 worker) {
+    sweep_job* job = ctx;
+    u32 width = job->world->width;
+    u32 height = job->world->height;
+    u32 minor_size = job->along_x ? height : width;
+    float* data = job->world->data;
+    float* hull_t = &job->hull_t[(size_t)worker * job->length];
+    float* hull_z = &job->hull_z[(size_t)worker * job->length];
+    float z_scale = job->h->z_scale;
+
+    for (u32 line = begin; line < end; line++) {
+        int origin = job->first_line + (int)line;
+        int top = 0;
+
+        // walk from the far end of the line back, so the hull holds the
+        // terrain in the look direction of the current cell
+        for (u32 k = 0; k < job->length; k++) {
+            u32 major = job->step > 0 ? job->length - 1 - k : k;
+            int minor = origin + (int)lrintf(job->slope * (float)major);
+            if (minor < 0 || minor >= (int)minor_size) continue;
+
+            u32 x = job->along_x ? major : (u32)minor;
+            u32 y = job->along_x ? (u32)minor : major;
+            float t = (float)major * job->spacing * (float)job->step;
+            float z = data[x + y * width] * z_scale;
+
+            // drop hull points under the segment from this cell to the next
+            while (top >= 2) {
+                float s1 = (hull_z[top-1] - z) * (hull_t[top-2] - t);
+                float s2 = (hull_z[top-2] - z) * (hull_t[top-1] - t);
+                if (s1 > s2) break;
+                top--;
+            }
+
+            u32 code = 0;
+            if (top > 0) {
+                code = quantize((hull_z[top-1] - z) / (hull_t[top-1] - t));
+            }
+            job->plane[x + y * width] = (u8)code;
+
+            hull_t[top] = t;
+            hull_z[top] = z;
+            top++;
+        }
+    }
+}
+
+rs_horizon* rs_make_horizon(rs_grid* world, u32 num_dirs, float z_scale) {
+    if (num_dirs == 0) num_dirs = 1;
+
+    rs_pool* pool = rs_default_pool();
+    u32 workers = rs_pool_size(pool);
+
+    rs_horizon* h = malloc(sizeof(rs_horizon));
+    h->width = world->width;
+    h->height = world->height;
+    h->num_dirs = num_dirs;
+    h->z_scale = z_scale;
+    h->angles = malloc((size_t)num_dirs * world->size);
+
+    u32 longest = world->width > world->height ? world->width : world->height;
+    float* hull_t = malloc((size_t)workers * longest * sizeof(float));
+    float* hull_z = malloc((size_t)workers * longest * sizeof(float));
+
+    for (u32 d = 0; d < num_dirs; d++) {
+        float azimuth = TWO_PI * d / num_dirs;
+        float dx = cosf(azimuth);
+        float dy = sinf(azimuth);
+
+        sweep_job job;
+        job.world = world;
+        job.h = h;
+        job.plane = &h->angles[(size_t)d * world->size];
+        job.along_x = fabsf(dx) >= fabsf(dy);
+        job.step = (job.along_x ? dx : dy) > 0 ? 1 : -1;
+        job.slope = job.along_x ? dy / dx : dx / dy;
+        job.spacing = sqrtf(1 + job.slope * job.slope);
+        job.length = job.along_x ? world->width : world->height;
+        job.hull_t = hull_t;
+        job.hull_z = hull_z;
+
+        // line origins reaching every cell of the minor axis
+        u32 minor_size = job.along_x ? world->height : world->width;
+        int reach = (int)lrintf(job.slope * (float)(job.length - 1));
+        job.first_line = reach > 0 ? -reach : 0;
+        u32 num_lines = minor_size + (u32)abs(reach);
+
+        rs_pool_parallel_for(pool, num_lines, LINE_GRAIN, sweep_lines, &job);
+    }
+
+    free(hull_t);
+    free(hull_z);
+    return h;
+}
+
+void rs_free_horizon(rs_horizon* h) {
+    free(h->angles);
+    free(h);
+}
+
+//
+// lookups
+//
+
+typedef struct {
+    u32 d0, d1;
+    float f;
+} dir_pair;
+
+static dir_pair directions(rs_horizon* h, float azimuth) {
+    float a = fmodf(azimuth, TWO_PI);
+    if (a < 0) a += TWO_PI;
+    float pos = a / TWO_PI * h->num_dirs;
+    dir_pair p;
+    p.d0 = (u32)pos % h->num_dirs;
+    p.d1 = (p.d0 + 1) % h->num_dirs;
+    p.f = pos - floorf(pos);
+    return p;
+}
+
+static float angle_at(rs_horizon* h, dir_pair p, size_t cell) {
+    size_t size = (size_t)h->width * h->height;
+    float a0 = h->angles[p.d0 * size + cell];
+    float a1 = h->angles[p.d1 * size + cell];
+    return (a0 + (a1 - a0) * p.f) * (HALF_PI / 255.0f);
+}
+
+static float shadow_of(float horizon, float elevation, float softness) {
+    if (softness <= 0) return elevation > horizon ? 1.0f : 0.0f;
+    float s = (elevation - horizon) / softness + 0.5f;
+    return s < 0 ? 0 : (s > 1 ? 1 : s);
+}
+
+float rs_horizon_angle(rs_horizon* h, u32 x, u32 y, float azimuth) {
+    if (x >= h->width || y >= h->height) return 0;
+    return angle_at(h, directions(h, azimuth), x + (size_t)y * h->width);
+}
+
+float rs_horizon_shadow(rs_horizon* h, u32 x, u32 y, float azimuth, float elevation, float softness) {
+    return shadow_of(rs_horizon_angle(h, x, y, azimuth), elevation, softness);
+}
+
+typedef struct {
+    rs_horizon* h;
+    rs_grid* lightmap;
+    dir_pair dirs;
+    float elevation;
+    float softness;
+} shade_job;
+
+static void shade_rows(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    shade_job* job = ctx;
+    u32 width = job->h->width;
+    for (u32 y = begin; y < end; y++) {
+        for (u32 x = 0; x < width; x++) {
+            size_t cell = x + (size_t)y * width;
+            float horizon = angle_at(job->h, job->dirs, cell);
+            job->lightmap->data[cell] *= shadow_of(horizon, job->elevation, job->softness);
+        }
+    }
+}
+
+void rs_horizon_shade(rs_horizon* h, rs_grid* lightmap, float azimuth, float elevation, float softness) {
+    if (lightmap->width != h->width || lightmap->height != h->height) return;
+    shade_job job = { h, lightmap, directions(h, azimuth), elevation, softness };
+    rs_pool_parallel_for(rs_default_pool(), h->height, SHADE_ROWS, shade_rows, &job);
+}
@@ -0,0 +1,38 @@
+#ifndef RS_HORIZON_H
+#define RS_HORIZON_H
+
+#include "rs.h"
+
+#define RS_HORIZON_DIRECTIONS (16)
+
+//
+// horizon map: for every cell and each of num_dirs azimuths the elevation
+// angle of the highest terrain seen looking that way, stored as a byte
+// over [0, pi/2]. building it is a line sweep per azimuth that keeps the
+// upper convex hull of the terrain already passed, so every cell is pushed
+// and popped at most once per azimuth. afterwards whether a cell sees the
+// sun is a lookup and a compare for any sun position.
+//
+// azimuths are radians in grid space, 0 looking along +x and pi/2 along
+// +y. elevations are radians above the horizontal.
+//
+typedef struct {
+    u32 width;
+    u32 height;
+    u32 num_dirs;
+    float z_scale;            // cells per unit of height
+    u8* angles;               // num_dirs planes of width * height
+} rs_horizon;
+
+// num_dirs of 0 is taken as 1
+rs_horizon* rs_make_horizon(rs_grid* world, u32 num_dirs, float z_scale);
+void rs_free_horizon(rs_horizon* h);
+
+// horizon elevation at a cell, interpolated between the nearest azimuths
+float rs_horizon_angle(rs_horizon* h, u32 x, u32 y, float azimuth);
+// 1 in full sun, 0 in shadow, softened over softness radians of elevation
+float rs_horizon_shadow(rs_horizon* h, u32 x, u32 y, float azimuth, float elevation, float softness);
+// multiplies every cell of lightmap by its shadow factor
+void rs_horizon_shade(rs_horizon* h, rs_grid* lightmap, float azimuth, float elevation, float softness);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef RS_NOISE_INTERNAL_H
+#define RS_NOISE_INTERNAL_H
+
+// helpers rs_perlin.c shares with rs_simplex.c, not part of the noise API.
+// include only from those two files
+
+// dot products of the hashed lattice gradient with (x, y, ...)
+float grad1( int hash, float x );
+float grad2( int hash, float x, float y );
+float grad3( int hash, float x, float y, float z );
+float grad4( int hash, float x, float y, float z, float t );
+
+#endif
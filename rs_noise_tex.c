@@ -0,0 +1,248 @@
+#include <stdlib.h>
+#include <math.h>
+#include "rs_noise_tex.h"
+#include "rs_perlin.h"
+#include "rs_simplex.h"
+#include "rs_pool.h"
+#include "rs_stats.h"
+
+#define BAKE_ROWS (8)
+
+//
+// baking
+//
+
+// octaves with their periods in lattice cells over the whole texture
+typedef struct {
+    int count;
+    int px[RS_MAX_PLAN_OCTAVES];
+    int py[RS_MAX_PLAN_OCTAVES];
+    int pz[RS_MAX_PLAN_OCTAVES];
+    float amplitude[RS_MAX_PLAN_OCTAVES];
+} bake_octaves;
+
+typedef struct {
+    u32 engine;
+    rs_noise noise;
+    bake_octaves oct;
+    u32 width, height, depth;
+    rs_grid** slices;
+} bake_job;
+
+// whole lattice cells of an octave across n texels, at least one
+static int octave_period(u32 n, float scale, float frequency) {
+    long p = lrintf((float)n / scale * frequency);
+    return p > 0 ? (int)p : 1;
+}
+
+// snaps every octave to a whole number of periods and fades out the ones
+// with less than two texels per lattice cell, like cnoise2_filtered()
+static void plan_octaves(bake_octaves* b, u32 width, u32 height, u32 depth, float z_scale, rs_layer_params* l) {
+    float frequency = 1.0;
+    float amplitude = 1.0;
+    int octaves = (int)l->octaves;
+    b->count = 0;
+    for (int o = 0; o < octaves && b->count < RS_MAX_PLAN_OCTAVES; o++) {
+        int px = octave_period(width, l->scale, frequency);
+        int py = octave_period(height, l->scale, frequency);
+        int pz = octave_period(depth, z_scale, frequency);
+        float finest = fmaxf((float)px / width, (float)py / height);
+        if (depth > 1) finest = fmaxf(finest, (float)pz / depth);
+        float weight = fbm_octave_weight(finest, 1.0f);
+        if (weight > 0) {
+            b->px[b->count] = px;
+            b->py[b->count] = py;
+            b->pz[b->count] = pz;
+            b->amplitude[b->count] = amplitude * weight;
+            b->count++;
+        }
+        amplitude *= l->persistence;
+        frequency *= l->lacunarity;
+    }
+}
+
+static void bake_rows(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    bake_job* job = ctx;
+    bake_octaves* b = &job->oct;
+
+    for (u32 r = begin; r < end; r++) {
+        u32 z = r / job->height;
+        u32 y = r % job->height;
+        float* row = &job->slices[z]->data[y * job->width];
+        for (u32 x = 0; x < job->width; x++) {
+            float total = 0;
+            for (int o = 0; o < b->count; o++) {
+                float u = (float)x * b->px[o] / job->width;
+                float v = (float)y * b->py[o] / job->height;
+                float n;
+                if (job->depth > 1) {
+                    float w = (float)z * b->pz[o] / job->depth;
+                    n = pnoise3_ctx(&job->noise, u, v, w, b->px[o], b->py[o], b->pz[o]);
+                }
+                else if (job->engine == RS_NOISE_SIMPLEX) {
+                    n = psnoise2_ctx(&job->noise, u, v, b->px[o], b->py[o]);
+                }
+                else {
+                    n = pnoise2_ctx(&job->noise, u, v, b->px[o], b->py[o]);
+                }
+                total += n * b->amplitude[o];
+            }
+            row[x] = total;
+        }
+    }
+}
+
+// fills and normalizes the slices together, so a volume doesn't flicker
+static void bake(bake_job* job, rs_layer_params* l) {
+    rs_noise_init(&job->noise, l->seed);
+    rs_pool_parallel_for(rs_default_pool(), job->height * job->depth, BAKE_ROWS, bake_rows, job);
+
+    rs_range r = rs_grid_minmax(job->slices[0]);
+    for (u32 z = 1; z < job->depth; z++) {
+        r = rs_range_merge(r, job->slices[z]->data, job->slices[z]->size);
+    }
+    if (r.min > r.max) return;
+    for (u32 z = 0; z < job->depth; z++) {
+        rs_grid_remap(job->slices[z], r.min, r.max, l->lo, l->hi);
+    }
+}
+
+rs_grid* rs_bake_noise_tex(u32 width, u32 height, rs_layer_params* l) {
+    rs_grid* t = rs_make_grid(width, height);
+    bake_job job;
+    job.engine = l->engine;
+    job.width = width;
+    job.height = height;
+    job.depth = 1;
+    job.slices = &t;
+    plan_octaves(&job.oct, width, height, 1, 1.0f, l);
+    bake(&job, l);
+    return t;
+}
+
+rs_noise_volume* rs_bake_noise_volume(u32 width, u32 height, u32 depth, float z_scale, rs_layer_params* l) {
+    rs_noise_volume* v = malloc(sizeof(rs_noise_volume));
+    v->width = width;
+    v->height = height;
+    v->depth = depth > 0 ? depth : 1;
+    v->slices = malloc(v->depth * sizeof(rs_grid*));
+    for (u32 z = 0; z < v->depth; z++) {
+        v->slices[z] = rs_make_grid(width, height);
+    }
+
+    bake_job job;
+    job.engine = RS_NOISE_PERLIN;
+    job.width = width;
+    job.height = height;
+    job.depth = v->depth;
+    job.slices = v->slices;
+    plan_octaves(&job.oct, width, height, v->depth, z_scale, l);
+    bake(&job, l);
+    return v;
+}
+
+void rs_free_noise_volume(rs_noise_volume* v) {
+    for (u32 z = 0; z < v->depth; z++) {
+        rs_free_grid(v->slices[z]);
+    }
+    free(v->slices);
+    free(v);
+}
+
+//
+// sampling
+//
+
+static inline u32 wrap(int i, u32 n) {
+    // power of two sizes wrap with a mask, negative i included
+    if ((n & (n - 1)) == 0) return (u32)i & (n - 1);
+    int m = i % (int)n;
+    return m < 0 ? (u32)(m + (int)n) : (u32)m;
+}
+
+// integer texel and fraction of a coordinate, the texel wrapped
+static inline u32 split(float x, u32 n, float* f) {
+    float fl = floorf(x);
+    *f = x - fl;
+    // far away coordinates are wrapped in float first so they fit an int
+    if (fabsf(fl) >= 1e9f) fl = fmodf(fl, (float)n);
+    return wrap((int)fl, n);
+}
+
+float rs_tex_bilinear(rs_grid* t, float x, float y) {
+    float fx, fy;
+    u32 x0 = split(x, t->width, &fx);
+    u32 y0 = split(y, t->height, &fy);
+    u32 x1 = x0 + 1 < t->width ? x0 + 1 : 0;
+    u32 y1 = y0 + 1 < t->height ? y0 + 1 : 0;
+    float* r0 = &t->data[y0 * t->width];
+    float* r1 = &t->data[y1 * t->width];
+    float a = r0[x0] + fx * (r0[x1] - r0[x0]);
+    float b = r1[x0] + fx * (r1[x1] - r1[x0]);
+    return a + fy * (b - a);
+}
+
+static inline float catmull_rom(float p0, float p1, float p2, float p3, float t) {
+    return p1 + 0.5f * t * (p2 - p0 + t * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3
+                                           + t * (3.0f * (p1 - p2) + p3 - p0)));
+}
+
+float rs_tex_bicubic(rs_grid* t, float x, float y) {
+    float fx, fy;
+    u32 x1 = split(x, t->width, &fx);
+    u32 y1 = split(y, t->height, &fy);
+    u32 xs[4] = { wrap((int)x1 - 1, t->width), x1, wrap((int)x1 + 1, t->width), wrap((int)x1 + 2, t->width) };
+    float col[4];
+    for (int j = 0; j < 4; j++) {
+        float* row = &t->data[wrap((int)y1 + j - 1, t->height) * t->width];
+        col[j] = catmull_rom(row[xs[0]], row[xs[1]], row[xs[2]], row[xs[3]], fx);
+    }
+    return catmull_rom(col[0], col[1], col[2], col[3], fy);
+}
+
+typedef struct {
+    rs_grid* t;
+    rs_grid* dst;
+    float x0, y0, step;
+    int bicubic;
+} fill_job;
+
+static void fill_rows(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    fill_job* job = ctx;
+    for (u32 y = begin; y < end; y++) {
+        float* row = &job->dst->data[y * job->dst->width];
+        float sy = job->y0 + y * job->step;
+        for (u32 x = 0; x < job->dst->width; x++) {
+            float sx = job->x0 + x * job->step;
+            row[x] = job->bicubic ? rs_tex_bicubic(job->t, sx, sy) : rs_tex_bilinear(job->t, sx, sy);
+        }
+    }
+}
+
+void rs_tex_fill(rs_grid* t, rs_grid* dst, float x0, float y0, float step, int bicubic) {
+    fill_job job = { t, dst, x0, y0, step, bicubic };
+    rs_pool_parallel_for(rs_default_pool(), dst->height, BAKE_ROWS, fill_rows, &job);
+}
+
+float rs_volume_sample(rs_noise_volume* v, float x, float y, float z) {
+    float fz;
+    u32 z0 = split(z, v->depth, &fz);
+    u32 z1 = z0 + 1 < v->depth ? z0 + 1 : 0;
+    float a = rs_tex_bilinear(v->slices[z0], x, y);
+    float b = rs_tex_bilinear(v->slices[z1], x, y);
+    return a + fz * (b - a);
+}
+
+void rs_volume_slice(rs_noise_volume* v, float z, rs_grid* dst) {
+    float fz;
+    u32 z0 = split(z, v->depth, &fz);
+    u32 z1 = z0 + 1 < v->depth ? z0 + 1 : 0;
+    float* a = v->slices[z0]->data;
+    float* b = v->slices[z1]->data;
+    u32 n = dst->size < v->slices[z0]->size ? dst->size : v->slices[z0]->size;
+    for (u32 i = 0; i < n; i++) {
+        dst->data[i] = a[i] + fz * (b[i] - a[i]);
+    }
+}
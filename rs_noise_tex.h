@@ -0,0 +1,47 @@
+#ifndef RS_NOISE_TEX_H
+#define RS_NOISE_TEX_H
+
+#include "rs.h"
+
+//
+// periodic fBm baked into tileable textures. a texture holds exactly one
+// period of a layer's noise, so detail noise, masks and animated water
+// that are sampled over and over cost a few wrapped table reads instead
+// of a noise evaluation per octave. the layer scale is in texels per
+// noise unit and is rounded so a whole number of periods fits, values
+// are normalized to [lo, hi] over the texture.
+//
+// sample coordinates are in texels, texel (x, y) sits at (x, y) and any
+// coordinate wraps. volumes stack depth slices of 3D noise that is
+// periodic in z as well, so z can be a looping time axis.
+//
+
+typedef struct {
+    u32 width;
+    u32 height;
+    u32 depth;
+    rs_grid** slices;         // depth tileable width x height slices
+} rs_noise_volume;
+
+// pnoise2 or psnoise2 per l->engine. octaves with less than two texels
+// per lattice cell are faded out, at most RS_MAX_PLAN_OCTAVES are baked
+rs_grid* rs_bake_noise_tex(u32 width, u32 height, rs_layer_params* l);
+// perlin noise whatever l->engine, simplex has no periodic 3D form. z_scale
+// is slices per noise unit, the scale of the xy plane is l->scale
+rs_noise_volume* rs_bake_noise_volume(u32 width, u32 height, u32 depth, float z_scale, rs_layer_params* l);
+void rs_free_noise_volume(rs_noise_volume* v);
+
+float rs_tex_bilinear(rs_grid* t, float x, float y);
+// catmull-rom over the 4x4 texels around (x, y), C1 where bilinear shows
+// creases under steep lighting, and may overshoot [lo, hi] slightly
+float rs_tex_bicubic(rs_grid* t, float x, float y);
+// dst cell (i, j) is t sampled at (x0 + i * step, y0 + j * step)
+void rs_tex_fill(rs_grid* t, rs_grid* dst, float x0, float y0, float step, int bicubic);
+
+// bilinear in the slices, linear between them
+float rs_volume_sample(rs_noise_volume* v, float x, float y, float z);
+// the width x height plane at z into dst, one blend of two slices per
+// frame for an animated field
+void rs_volume_slice(rs_noise_volume* v, float z, rs_grid* dst);
+
+#endif
@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <math.h>
+#include <immintrin.h>
+#include "rs_normals.h"
+#include "rs_pool.h"
+
+#define AVX2 __attribute__((target("avx2")))
+
+#define SNORM16_SCALE (32767.0f)
+// rows per task
+#define NORMAL_ROWS (16)
+
+static int has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static int16_t pack_snorm16(float v) {
+    return (int16_t)lrintf(v * SNORM16_SCALE);
+}
+
+typedef struct {
+    rs_normals* n;
+    rs_grid* world;
+    rs_grid* lightmap;
+    u32 x0, x1;
+    u32 y0;
+    float light_z;
+} normals_job;
+
+static void normal_rows(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    normals_job* job = ctx;
+    u32 width = job->world->width;
+    u32 height = job->world->height;
+    float* z = job->world->data;
+
+    for (u32 y = job->y0 + begin; y < job->y0 + end; y++) {
+        float* row = &z[y * width];
+        float* above = y > 0 ? row - width : row;
+        float* below = y < height - 1 ? row + width : row;
+        int16_t* out = &job->n->xy[2 * (size_t)y * width];
+
+        for (u32 x = job->x0; x < job->x1; x++) {
+            float left = x > 0 ? row[x-1] : row[x];
+            float right = x < width - 1 ? row[x+1] : row[x];
+
+            float nx = left - right;
+            float ny = above[x] - below[x];
+            float nz = 2.0f;
+            float len = sqrtf(nx * nx + ny * ny + nz * nz);
+
+            out[2*x] = pack_snorm16(nx / len);
+            out[2*x + 1] = pack_snorm16(ny / len);
+        }
+    }
+}
+
+rs_normals* rs_make_normals(rs_grid* world) {
+    rs_normals* n = malloc(sizeof(rs_normals));
+    n->width = world->width;
+    n->height = world->height;
+    n->xy = malloc(2 * (size_t)world->size * sizeof(int16_t));
+    rs_update_normals(n, world, 0, 0, world->width, world->height);
+    return n;
+}
+
+void rs_free_normals(rs_normals* n) {
+    free(n->xy);
+    free(n);
+}
+
+void rs_update_normals(rs_normals* n, rs_grid* world, u32 x0, u32 y0, u32 w, u32 h) {
+    // a height change moves the normals of the neighbours too
+    u32 x1 = x0 + w + 1 < world->width ? x0 + w + 1 : world->width;
+    u32 y1 = y0 + h + 1 < world->height ? y0 + h + 1 : world->height;
+    x0 = x0 > 0 ? x0 - 1 : 0;
+    y0 = y0 > 0 ? y0 - 1 : 0;
+    if (x0 >= x1 || y0 >= y1) return;
+
+    normals_job job = { n, world, NULL, x0, x1, y0, 0 };
+    rs_pool_parallel_for(rs_default_pool(), y1 - y0, NORMAL_ROWS, normal_rows, &job);
+}
+
+typedef struct {
+    rs_normals* n;
+    float* sx;
+    float* sy;
+    float z_scale;
+} slopes_job;
+
+static void slope_rows(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    slopes_job* job = ctx;
+    u32 width = job->n->width;
+
+    for (u32 y = begin; y < end; y++) {
+        float* sx = &job->sx[(size_t)y * width];
+        float* sy = &job->sy[(size_t)y * width];
+        int16_t* out = &job->n->xy[2 * (size_t)y * width];
+
+        for (u32 x = 0; x < width; x++) {
+            float nx = -sx[x] * job->z_scale;
+            float ny = -sy[x] * job->z_scale;
+            float len = sqrtf(nx * nx + ny * ny + 1.0f);
+
+            out[2*x] = pack_snorm16(nx / len);
+            out[2*x + 1] = pack_snorm16(ny / len);
+        }
+    }
+}
+
+void rs_update_normals_from_slopes(rs_normals* n, rs_grid* sx, rs_grid* sy, float z_scale) {
+    if (sx->width != n->width || sx->height != n->height) return;
+    if (sy->width != n->width || sy->height != n->height) return;
+    slopes_job job = { n, sx->data, sy->data, z_scale };
+    rs_pool_parallel_for(rs_default_pool(), n->height, NORMAL_ROWS, slope_rows, &job);
+}
+
+rs_normals* rs_make_normals_from_slopes(rs_grid* sx, rs_grid* sy, float z_scale) {
+    rs_normals* n = malloc(sizeof(rs_normals));
+    n->width = sx->width;
+    n->height = sx->height;
+    n->xy = malloc(2 * (size_t)sx->size * sizeof(int16_t));
+    rs_update_normals_from_slopes(n, sx, sy, z_scale);
+    return n;
+}
+
+rs_normals* rs_terra_normals(rs_terra* t) {
+    if (t->normals == NULL) {
+        t->normals = rs_make_normals(t->map);
+    }
+    return t->normals;
+}
+
+//
+// relighting
+//
+
+static float light_cell(int16_t* xy, float z, float x, float y, float light_z) {
+    float nx = xy[0] * (1.0f / SNORM16_SCALE);
+    float ny = xy[1] * (1.0f / SNORM16_SCALE);
+    float nz = sqrtf(fmaxf(0.0f, 1.0f - nx * nx - ny * ny));
+
+    // the light direction of rs_calculate_lighting(), from (1, 1, light_z)
+    float lx = x - 1;
+    float ly = y - 1;
+    float lz = z - light_z;
+    float len = sqrtf(lx * lx + ly * ly + lz * lz);
+
+    float dot = (lx * nx + ly * ny + lz * nz) / len;
+    return fmaxf(0.0f, -dot);
+}
+
+AVX2 static u32 light_row_avx2(int16_t* xy, float* z, float* out, u32 width, float y, float light_z) {
+    __m256 scale = _mm256_set1_ps(1.0f / SNORM16_SCALE);
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256 zero = _mm256_setzero_ps();
+    __m256 lz0 = _mm256_set1_ps(light_z);
+    __m256 ly = _mm256_set1_ps(y - 1);
+    __m256 ly2 = _mm256_mul_ps(ly, ly);
+    __m256 lanes = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+
+    u32 x = 0;
+    for (; x + 8 <= width; x += 8) {
+        // eight (x, y) snorm16 pairs, x in the low half of every 32 bits
+        __m256i pairs = _mm256_loadu_si256((__m256i*)&xy[2*x]);
+        __m256 nx = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(pairs, 16), 16)), scale);
+        __m256 ny = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(pairs, 16)), scale);
+        __m256 nz = _mm256_sub_ps(_mm256_sub_ps(one, _mm256_mul_ps(nx, nx)), _mm256_mul_ps(ny, ny));
+        nz = _mm256_sqrt_ps(_mm256_max_ps(nz, zero));
+
+        __m256 lx = _mm256_add_ps(_mm256_set1_ps((float)x - 1), lanes);
+        __m256 lz = _mm256_sub_ps(_mm256_loadu_ps(&z[x]), lz0);
+        __m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(lx, lx), ly2), _mm256_mul_ps(lz, lz));
+        __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(lx, nx), _mm256_mul_ps(ly, ny)), _mm256_mul_ps(lz, nz));
+        dot = _mm256_div_ps(dot, _mm256_sqrt_ps(len2));
+        _mm256_storeu_ps(&out[x], _mm256_max_ps(_mm256_sub_ps(zero, dot), zero));
+    }
+    return x;
+}
+
+static void light_rows(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    normals_job* job = ctx;
+    u32 width = job->world->width;
+    int avx2 = has_avx2();
+
+    for (u32 y = begin; y < end; y++) {
+        int16_t* xy = &job->n->xy[2 * (size_t)y * width];
+        float* z = &job->world->data[y * width];
+        float* out = &job->lightmap->data[y * width];
+
+        u32 x = avx2 ? light_row_avx2(xy, z, out, width, (float)y, job->light_z) : 0;
+        for (; x < width; x++) {
+            out[x] = light_cell(&xy[2*x], z[x], (float)x, (float)y, job->light_z);
+        }
+    }
+}
+
+void rs_light_normals(rs_grid* lightmap, rs_grid* world, rs_normals* n, rs_light* light) {
+    if (lightmap->size != world->size || n->width != world->width || n->height != world->height) {
+        return;
+    }
+
+    float z_at_light = rs_grid_get(world, round(light->x), round(light->y));
+    if (z_at_light >= light->z) {
+        // light is below surface, set intensity to 0 across the board
+        rs_grid_fill(lightmap, 0.0);
+        return;
+    }
+
+    normals_job job = { n, world, lightmap, 0, world->width, 0, light->z };
+    rs_pool_parallel_for(rs_default_pool(), world->height, NORMAL_ROWS, light_rows, &job);
+}
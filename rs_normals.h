@@ -0,0 +1,34 @@
+#ifndef RS_NORMALS_H
+#define RS_NORMALS_H
+
+#include "rs.h"
+
+//
+// surface normals are a function of the terrain only, so they are built
+// once and kept packed (4 bytes a cell instead of 12). relighting after the
+// light moves is then one row-major pass over heights and normals.
+//
+// the normal of a cell is (left - right, top - bottom, 2) normalized, with
+// the cell's own height standing in for neighbours past the edge.
+//
+
+rs_normals* rs_make_normals(rs_grid* world);
+void rs_free_normals(rs_normals* n);
+// rebuilds the normals of the cells in the rect and its one cell border,
+// after the heights in the rect changed
+void rs_update_normals(rs_normals* n, rs_grid* world, u32 x0, u32 y0, u32 w, u32 h);
+
+// normals straight from analytic slopes (see perlin_fill_slopes), the
+// normal of (-dz/dx, -dz/dy, 1) with the slopes scaled by z_scale to the
+// units of the heights, no neighbours read
+rs_normals* rs_make_normals_from_slopes(rs_grid* sx, rs_grid* sy, float z_scale);
+void rs_update_normals_from_slopes(rs_normals* n, rs_grid* sx, rs_grid* sy, float z_scale);
+
+// cached normals of the terra's map, built on first call
+rs_normals* rs_terra_normals(rs_terra* t);
+
+// lights every cell of lightmap from the cached normals, same model as
+// rs_calculate_lighting()
+void rs_light_normals(rs_grid* lightmap, rs_grid* world, rs_normals* n, rs_light* light);
+
+#endif
@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <math.h>
+#include "rs_particles.h"
+#include "rs_rand.h"
+
+#define SEED_GRAIN (4096)
+#define REPLICATE_GRAIN (1024)
+
+//
+// mass field functions
+//
+
+rs_grid* rs_make_mass_field(Image image, int invert, float mass_lo, float mass_hi) {
+    rs_grid* field = rs_make_grid(image.width, image.height);
+    Color* pixels = LoadImageColors(image);
+
+    for (u32 i = 0; i < field->size; i++) {
+        Color c = pixels[i];
+        u8 cmax = c.r > c.g ? c.r : c.g;
+        if (c.b > cmax) cmax = c.b;
+
+        float b = (float)cmax / 255.0f;
+        if (invert) b = 1.0f - b;
+        field->data[i] = mass_lo + b * (mass_hi - mass_lo);
+    }
+
+    UnloadImageColors(pixels);
+    return field;
+}
+
+Vector2 rs_mass_field_to_world(rs_grid* field, float px, float py) {
+    return (Vector2) {
+        (px - field->width/2.0f) / RS_IMAGE_SCALE,
+        (py - field->height/2.0f) / RS_IMAGE_SCALE
+    };
+}
+
+float rs_mass_field_at(rs_grid* field, Vector2 world, float outside_mass) {
+    int px = (int)roundf(field->width/2.0f + world.x * RS_IMAGE_SCALE);
+    int py = (int)roundf(field->height/2.0f + world.y * RS_IMAGE_SCALE);
+    if (px < 0 || px >= (int)field->width) return outside_mass;
+    if (py < 0 || py >= (int)field->height) return outside_mass;
+    return field->data[px + py * field->width];
+}
+
+//
+// rs_alias functions
+//
+
+rs_alias* rs_make_alias(const float* weights, u32 n) {
+    rs_alias* a = malloc(sizeof(rs_alias));
+    a->size = n;
+    a->prob = malloc(n * sizeof(float));
+    a->alias = malloc(n * sizeof(u32));
+
+    double sum = 0;
+    for (u32 i = 0; i < n; i++) {
+        sum += weights[i] > 0 ? weights[i] : 0;
+    }
+
+    if (sum <= 0) {
+        for (u32 i = 0; i < n; i++) {
+            a->prob[i] = 1.0f;
+            a->alias[i] = i;
+        }
+        return a;
+    }
+
+    // small entries are stacked from the front of the worklist, large
+    // ones from the back, so one array of n indices holds both
+    u32* work = malloc(n * sizeof(u32));
+    u32 small = 0;
+    u32 large = n;
+    double scale = n / sum;
+    for (u32 i = 0; i < n; i++) {
+        a->prob[i] = (float)((weights[i] > 0 ? weights[i] : 0) * scale);
+        a->alias[i] = i;
+        if (a->prob[i] < 1.0f) work[small++] = i;
+        else work[--large] = i;
+    }
+
+    while (small > 0 && large < n) {
+        u32 s = work[--small];
+        u32 l = work[large++];
+        a->alias[s] = l;
+        a->prob[l] = (a->prob[l] + a->prob[s]) - 1.0f;
+        if (a->prob[l] < 1.0f) work[small++] = l;
+        else work[--large] = l;
+    }
+
+    // whatever is left is 1 up to rounding error
+    while (small > 0) a->prob[work[--small]] = 1.0f;
+    while (large < n) a->prob[work[large++]] = 1.0f;
+
+    free(work);
+    return a;
+}
+
+void rs_free_alias(rs_alias* a) {
+    free(a->prob);
+    free(a->alias);
+    free(a);
+}
+
+//
+// seeding functions
+//
+
+typedef struct {
+    particle* dst;
+    rs_alias* alias;
+    rs_grid* field;
+    u64 seed;
+} seed_job;
+
+static void seed_range(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    seed_job* job = ctx;
+    rs_alias* alias = job->alias;
+    rs_grid* field = job->field;
+
+    // one stream per chunk, chunk boundaries are fixed by SEED_GRAIN
+    rs_rng rng = rs_make_rng(job->seed, begin / SEED_GRAIN);
+
+    for (u32 i = begin; i < end; i++) {
+        u32 cell = rs_rng_below(&rng, alias->size);
+        if (rs_rng_float(&rng) >= alias->prob[cell]) {
+            cell = alias->alias[cell];
+        }
+
+        // jitter within the pixel, round() in sample_color maps back to it
+        float px = (float)(cell % field->width) + rs_rng_float(&rng) - 0.5f;
+        float py = (float)(cell / field->width) + rs_rng_float(&rng) - 0.5f;
+
+        particle* p = &job->dst[i];
+        p->position = rs_mass_field_to_world(field, px, py);
+        p->velocity = (Vector2) { 0, 0 };
+        p->acceleration = (Vector2) { 0, 0 };
+        p->mass = (Vector2) { field->data[cell], 0 };
+    }
+}
+
+void rs_seed_particles(particle* dst, u32 n, rs_alias* alias, rs_grid* field, u64 seed, rs_pool* pool) {
+    if (alias->size == 0) return;
+    seed_job job = { dst, alias, field, seed };
+    rs_pool_parallel_for(pool, n, SEED_GRAIN, seed_range, &job);
+}
+
+typedef struct {
+    particle* p;
+    u32 count;
+    rs_grid* field;
+    float outside_mass;
+    u64 seed;
+} replicate_job;
+
+static void replicate_range(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    replicate_job* job = ctx;
+    particle* dst = job->p + job->count;
+    rs_rng rng = rs_make_rng(job->seed, begin / REPLICATE_GRAIN);
+
+    for (u32 i = begin; i < end; i++) {
+        u32 j = rs_rng_below(&rng, job->count);
+        u32 jitter = rs_rng_u32(&rng);
+        float dx = (float)((int)((jitter & 0xffff) * (2*RS_REPLICATE_JITTER + 1) >> 16) - RS_REPLICATE_JITTER);
+        float dy = (float)((int)((jitter >> 16) * (2*RS_REPLICATE_JITTER + 1) >> 16) - RS_REPLICATE_JITTER);
+
+        Vector2 position = { job->p[j].position.x + dx, job->p[j].position.y + dy };
+        dst[i].position = position;
+        dst[i].velocity = (Vector2) { 0, 0 };
+        dst[i].acceleration = (Vector2) { 0, 0 };
+        dst[i].mass = (Vector2) { rs_mass_field_at(job->field, position, job->outside_mass), 0 };
+    }
+}
+
+u32 rs_replicate_particles(particle* p, u32 count, u32 capacity, u32 n, rs_grid* field, float outside_mass, u64 seed, rs_pool* pool) {
+    if (count == 0 || count >= capacity) return 0;
+    if (n > capacity - count) n = capacity - count;
+
+    // sources are only drawn from [0, count), so the new particles can be
+    // written straight into the tail while other chunks read the head
+    replicate_job job = { p, count, field, outside_mass, seed };
+    rs_pool_parallel_for(pool, n, REPLICATE_GRAIN, replicate_range, &job);
+    return n;
+}
+
+u32 rs_spawn_particles(particle* p, u32 count, u32 capacity, u32 n, Vector2 center, float radius, rs_grid* field, float outside_mass, u64 seed) {
+    if (count >= capacity) return 0;
+    if (n > capacity - count) n = capacity - count;
+
+    rs_rng rng = rs_make_rng(seed, 0);
+    for (u32 i = count; i < count + n; i++) {
+        float r = radius * sqrtf(rs_rng_float(&rng));
+        float theta = 2 * PI * rs_rng_float(&rng);
+        Vector2 position = { center.x + r * cosf(theta), center.y + r * sinf(theta) };
+
+        p[i].position = position;
+        p[i].velocity = (Vector2) { 0, 0 };
+        p[i].acceleration = (Vector2) { 0, 0 };
+        p[i].mass = (Vector2) { rs_mass_field_at(field, position, outside_mass), 0 };
+    }
+    return n;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    u32 x = *(const u32*)a;
+    u32 y = *(const u32*)b;
+    return (x > y) - (x < y);
+}
+
+u32 rs_remove_particles(particle* p, u32 count, u32* remove, u32 n) {
+    qsort(remove, n, sizeof(u32), compare_u32);
+
+    // fill the lowest hole with the last particle, unless the last particle
+    // is being removed too, in which case it is simply dropped
+    u32 lo = 0;
+    u32 hi = n;
+    while (lo < hi) {
+        u32 last = count - 1;
+        if (remove[hi - 1] == last) {
+            hi--;
+        }
+        else {
+            p[remove[lo]] = p[last];
+            lo++;
+        }
+        count--;
+    }
+    return count;
+}
@@ -0,0 +1,67 @@
+#ifndef RS_PARTICLES_H
+#define RS_PARTICLES_H
+
+#include <raylib.h>
+#include "rs.h"
+#include "rs_pool.h"
+
+// image pixels per world unit, see sample_color() in main.c
+#define RS_IMAGE_SCALE (5)
+
+// layout shared with the compute and fragment shaders
+typedef struct {
+    Vector2 position;
+    Vector2 velocity;
+    Vector2 acceleration;
+    Vector2 mass;
+} particle;
+
+// Vose alias table, samples index i with probability weight[i] / sum(weight)
+typedef struct {
+    u32 size;
+    float* prob;
+    u32* alias;
+} rs_alias;
+
+//
+// mass field functions
+//
+
+// per pixel particle mass for an image, the brightest channel of each pixel
+// mapped to [mass_lo, mass_hi], or to [mass_hi, mass_lo] when invert is set
+rs_grid* rs_make_mass_field(Image image, int invert, float mass_lo, float mass_hi);
+Vector2 rs_mass_field_to_world(rs_grid* field, float px, float py);
+
+// mass at a world position, outside_mass past the edges of the image
+float rs_mass_field_at(rs_grid* field, Vector2 world, float outside_mass);
+
+//
+// rs_alias functions
+//
+rs_alias* rs_make_alias(const float* weights, u32 n);
+void rs_free_alias(rs_alias* a);
+
+//
+// seeding functions
+//
+
+// writes n particles to dst, placed with density proportional to the mass
+// field and at rest. the result only depends on seed, not on the pool.
+void rs_seed_particles(particle* dst, u32 n, rs_alias* alias, rs_grid* field, u64 seed, rs_pool* pool);
+
+// appends up to n copies of randomly chosen particles among the first count,
+// each jittered by up to RS_REPLICATE_JITTER world units on both axes and
+// weighed from the mass field. stops at capacity, returns the number added.
+#define RS_REPLICATE_JITTER (5)
+u32 rs_replicate_particles(particle* p, u32 count, u32 capacity, u32 n, rs_grid* field, float outside_mass, u64 seed, rs_pool* pool);
+
+// appends up to n particles spread uniformly over a disk and weighed from
+// the mass field. stops at capacity, returns the number added.
+u32 rs_spawn_particles(particle* p, u32 count, u32 capacity, u32 n, Vector2 center, float radius, rs_grid* field, float outside_mass, u64 seed);
+
+// removes the particles at the n given indices by moving particles from the
+// end of the array into the holes, the order of the rest is not kept.
+// remove is sorted in place and must not hold duplicates. returns the new count.
+u32 rs_remove_particles(particle* p, u32 count, u32* remove, u32 n);
+
+#endif
@@ -25,10 +25,16 @@
  *
  */
 
+#include <stdlib.h>
+#include <string.h>
 #include "rs_perlin.h"
+#include "rs_noise_internal.h"
+#include "rs_rand.h"
 
 // This is the new and improved, C(2) continuous interpolant
 #define FADE(t) ( t * t * t * ( t * ( t * 6 - 15 ) + 10 ) )
+// and its derivative, 30 t^2 (t - 1)^2
+#define DFADE(t) ( t * t * ( t * ( t * 30 - 60 ) + 30 ) )
 
 #define FASTFLOOR(x) ( ((int)(x)<(x)) ? ((int)x) : ((int)x-1 ) )
 #define LERP(t, a, b) ((a) + (t)*((b)-(a)))
@@ -53,8 +59,15 @@
  * This array is accessed a *lot* by the noise functions.
  * A vector-valued noise over 3D accesses it 96 times, and a
  * float-valued 4D noise 64 times. We want this to fit in the cache!
+ *
+ * The three zero bytes past the 512 entries let the SIMD batch code in
+ * rs_perlin_batch.c gather a 32-bit word at any index and mask off the
+ * low byte without reading past the end of the table.
+ *
+ * This is the table of the seed 0 context, seeded contexts shuffle their
+ * own copy (see rs_noise_init below).
  */
-unsigned char perm[] = {151,160,137,91,90,15,
+static const rs_noise reference_noise = { 0, {151,160,137,91,90,15,
   131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
   190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
   88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
@@ -80,7 +93,7 @@ unsigned char perm[] = {151,160,137,91,90,15,
   251,34,242,193,238,210,144,12,191,179,162,241, 81,51,145,235,249,14,239,107,
   49,192,214, 31,181,199,106,157,184, 84,204,176,115,121,50,45,127, 4,150,254,
   138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
-};
+} };
 
 //---------------------------------------------------------------------
 
@@ -116,6 +129,15 @@ float grad2( int hash, float x, float y ) {
     return ((h&1)? -u : u) + ((h&2)? -2.0*v : 2.0*v);
 }
 
+// the gradient grad2() dots with, d/dx and d/dy of grad2( hash, x, y )
+static void grad2_coeffs( int hash, float* gx, float* gy ) {
+    int h = hash & 7;
+    float u = (h&1) ? -1.0f : 1.0f;
+    float v = (h&2) ? -2.0f : 2.0f;
+    *gx = h<4 ? u : v;
+    *gy = h<4 ? v : u;
+}
+
 float grad3( int hash, float x, float y , float z ) {
     int h = hash & 15;     // Convert low 4 bits of hash code into 12 simple
     float u = h<8 ? x : y; // gradient directions, and compute dot product.
@@ -134,8 +156,9 @@ float grad4( int hash, float x, float y, float z, float t ) {
 //---------------------------------------------------------------------
 /** 1D float Perlin noise, SL "noise()"
  */
-float noise1( float x )
+float noise1_ctx( const rs_noise* ctx, float x )
 {
+    const unsigned char* perm = ctx->perm;
     int ix0, ix1;
     float fx0, fx1;
     float s, n0, n1;
@@ -156,8 +179,9 @@ float noise1( float x )
 //---------------------------------------------------------------------
 /** 1D float Perlin periodic noise, SL "pnoise()"
  */
-float pnoise1( float x, int px )
+float pnoise1_ctx( const rs_noise* ctx, float x, int px )
 {
+    const unsigned char* perm = ctx->perm;
     int ix0, ix1;
     float fx0, fx1;
     float s, n0, n1;
@@ -179,8 +203,9 @@ float pnoise1( float x, int px )
 //---------------------------------------------------------------------
 /** 2D float Perlin noise.
  */
-float noise2( float x, float y )
+float noise2_ctx( const rs_noise* ctx, float x, float y )
 {
+    const unsigned char* perm = ctx->perm;
     int ix0, iy0, ix1, iy1;
     float fx0, fy0, fx1, fy1;
     float s, t, nx0, nx1, n0, n1;
@@ -210,11 +235,71 @@ float noise2( float x, float y )
     return 0.507f * ( LERP( s, n0, n1 ) );
 }
 
+//---------------------------------------------------------------------
+/** 2D float Perlin noise and its analytic gradient. The value is the same
+ *  as noise2, the gradient is the derivative of the interpolant, not a
+ *  finite difference.
+ */
+float noise2_deriv_ctx( const rs_noise* ctx, float x, float y, float* dx, float* dy )
+{
+    const unsigned char* perm = ctx->perm;
+    int ix0, iy0, ix1, iy1;
+    int h00, h01, h10, h11;
+    float fx0, fy0, fx1, fy1;
+    float s, t, ds, dt, g00, g01, g10, g11, n0, n1;
+    float ax00, ay00, ax01, ay01, ax10, ay10, ax11, ay11;
+    float n0x, n0y, n1x, n1y;
+
+    ix0 = FASTFLOOR( x ); // Integer part of x
+    iy0 = FASTFLOOR( y ); // Integer part of y
+    fx0 = x - ix0;        // Fractional part of x
+    fy0 = y - iy0;        // Fractional part of y
+    fx1 = fx0 - 1.0f;
+    fy1 = fy0 - 1.0f;
+    ix1 = (ix0 + 1) & 0xff;  // Wrap to 0..255
+    iy1 = (iy0 + 1) & 0xff;
+    ix0 = ix0 & 0xff;
+    iy0 = iy0 & 0xff;
+
+    t = FADE( fy0 );
+    s = FADE( fx0 );
+    dt = DFADE( fy0 );
+    ds = DFADE( fx0 );
+
+    h00 = perm[ix0 + perm[iy0]];
+    h01 = perm[ix0 + perm[iy1]];
+    h10 = perm[ix1 + perm[iy0]];
+    h11 = perm[ix1 + perm[iy1]];
+
+    g00 = grad2(h00, fx0, fy0);
+    g01 = grad2(h01, fx0, fy1);
+    n0 = LERP( t, g00, g01 );
+    g10 = grad2(h10, fx1, fy0);
+    g11 = grad2(h11, fx1, fy1);
+    n1 = LERP( t, g10, g11 );
+
+    grad2_coeffs(h00, &ax00, &ay00);
+    grad2_coeffs(h01, &ax01, &ay01);
+    grad2_coeffs(h10, &ax10, &ay10);
+    grad2_coeffs(h11, &ax11, &ay11);
+
+    // n0 and n1 lerp in y only, so only their y derivatives see dt
+    n0x = LERP( t, ax00, ax01 );
+    n0y = LERP( t, ay00, ay01 ) + dt * ( g01 - g00 );
+    n1x = LERP( t, ax10, ax11 );
+    n1y = LERP( t, ay10, ay11 ) + dt * ( g11 - g10 );
+
+    *dx = 0.507f * ( LERP( s, n0x, n1x ) + ds * ( n1 - n0 ) );
+    *dy = 0.507f * ( LERP( s, n0y, n1y ) );
+    return 0.507f * ( LERP( s, n0, n1 ) );
+}
+
 //---------------------------------------------------------------------
 /** 2D float Perlin periodic noise.
  */
-float pnoise2( float x, float y, int px, int py )
+float pnoise2_ctx( const rs_noise* ctx, float x, float y, int px, int py )
 {
+    const unsigned char* perm = ctx->perm;
     int ix0, iy0, ix1, iy1;
     float fx0, fy0, fx1, fy1;
     float s, t, nx0, nx1, n0, n1;
@@ -248,8 +333,9 @@ float pnoise2( float x, float y, int px, int py )
 //---------------------------------------------------------------------
 /** 3D float Perlin noise.
  */
-float noise3( float x, float y, float z )
+float noise3_ctx( const rs_noise* ctx, float x, float y, float z )
 {
+    const unsigned char* perm = ctx->perm;
     int ix0, iy0, ix1, iy1, iz0, iz1;
     float fx0, fy0, fz0, fx1, fy1, fz1;
     float s, t, r;
@@ -301,8 +387,9 @@ float noise3( float x, float y, float z )
 //---------------------------------------------------------------------
 /** 3D float Perlin periodic noise.
  */
-float pnoise3( float x, float y, float z, int px, int py, int pz )
+float pnoise3_ctx( const rs_noise* ctx, float x, float y, float z, int px, int py, int pz )
 {
+    const unsigned char* perm = ctx->perm;
     int ix0, iy0, ix1, iy1, iz0, iz1;
     float fx0, fy0, fz0, fx1, fy1, fz1;
     float s, t, r;
@@ -356,8 +443,9 @@ float pnoise3( float x, float y, float z, int px, int py, int pz )
 /** 4D float Perlin noise.
  */
 
-float noise4( float x, float y, float z, float w )
+float noise4_ctx( const rs_noise* ctx, float x, float y, float z, float w )
 {
+    const unsigned char* perm = ctx->perm;
     int ix0, iy0, iz0, iw0, ix1, iy1, iz1, iw1;
     float fx0, fy0, fz0, fw0, fx1, fy1, fz1, fw1;
     float s, t, r, q;
@@ -440,9 +528,10 @@ float noise4( float x, float y, float z, float w )
 /** 4D float Perlin periodic noise.
  */
 
-float pnoise4( float x, float y, float z, float w,
+float pnoise4_ctx( const rs_noise* ctx, float x, float y, float z, float w,
                             int px, int py, int pz, int pw )
 {
+    const unsigned char* perm = ctx->perm;
     int ix0, iy0, iz0, iw0, ix1, iy1, iz1, iw1;
     float fx0, fy0, fz0, fw0, fx1, fy1, fz1, fw1;
     float s, t, r, q;
@@ -524,14 +613,14 @@ float pnoise4( float x, float y, float z, float w,
 //---------------------------------------------------------------------
 //
 // Perlin noise with octaves, persistence, and lacunarity
-float cnoise2(float x, float y, int octaves, float persistence, float lacunarity) {
+float cnoise2_ctx(const rs_noise* ctx, float x, float y, int octaves, float persistence, float lacunarity) {
     float total = 0;
     float frequency = 1.0;
     float amplitude = 1.0;
     float maxValue = 0; // Used to normalize the result
 
     for (int i = 0; i < octaves; i++) {
-        total += noise2(x * frequency, y * frequency) * amplitude;
+        total += noise2_ctx(ctx, x * frequency, y * frequency) * amplitude;
         maxValue += amplitude;
         amplitude *= persistence;
         frequency *= lacunarity;
@@ -540,14 +629,90 @@ float cnoise2(float x, float y, int octaves, float persistence, float lacunarity
     return total / maxValue; // Normalize to [0, 1]
 }
 
-float cnoise3(float x, float y, float z, int octaves, float persistence, float lacunarity) {
+// 1 up to RS_FBM_FADE_START cycles per sample, smoothly down to 0 at the
+// Nyquist limit
+float fbm_octave_weight(float frequency, float footprint) {
+    float cycles = frequency * footprint;
+    if (cycles <= RS_FBM_FADE_START) return 1.0f;
+    if (cycles >= RS_FBM_NYQUIST) return 0.0f;
+    float t = (RS_FBM_NYQUIST - cycles) / (RS_FBM_NYQUIST - RS_FBM_FADE_START);
+    return t * t * (3 - 2 * t);
+}
+
+int rs_make_octave_plan(rs_octave_plan* plan, float footprint, int octaves, float persistence, float lacunarity) {
+    float frequency = 1.0;
+    float amplitude = 1.0;
+    plan->count = 0;
+    plan->max_value = 0;
+    for (int o = 0; o < octaves; o++) {
+        float weight = fbm_octave_weight(frequency, footprint);
+        if (weight > 0) {
+            if (plan->count == RS_MAX_PLAN_OCTAVES) return 0;
+            plan->frequency[plan->count] = frequency;
+            plan->amplitude[plan->count] = amplitude * weight;
+            plan->count++;
+        }
+        plan->max_value += amplitude;
+        amplitude *= persistence;
+        frequency *= lacunarity;
+    }
+    return 1;
+}
+
+float cnoise2_filtered_ctx(const rs_noise* ctx, float x, float y, float footprint,
+                           int octaves, float persistence, float lacunarity) {
+    float total = 0;
+    float frequency = 1.0;
+    float amplitude = 1.0;
+    float maxValue = 0;
+
+    for (int i = 0; i < octaves; i++) {
+        float weight = fbm_octave_weight(frequency, footprint);
+        if (weight > 0) {
+            total += noise2_ctx(ctx, x * frequency, y * frequency) * (amplitude * weight);
+        }
+        maxValue += amplitude;
+        amplitude *= persistence;
+        frequency *= lacunarity;
+    }
+
+    return total / maxValue;
+}
+
+// cnoise2 and its gradient, the sum of the octave gradients scaled by
+// their amplitude and frequency
+float cnoise2_deriv_ctx(const rs_noise* ctx, float x, float y, int octaves, float persistence, float lacunarity,
+                        float* dx, float* dy) {
+    float total = 0;
+    float total_dx = 0;
+    float total_dy = 0;
+    float frequency = 1.0;
+    float amplitude = 1.0;
+    float maxValue = 0;
+
+    for (int i = 0; i < octaves; i++) {
+        float nx, ny;
+        total += noise2_deriv_ctx(ctx, x * frequency, y * frequency, &nx, &ny) * amplitude;
+        total_dx += nx * (amplitude * frequency);
+        total_dy += ny * (amplitude * frequency);
+        maxValue += amplitude;
+        amplitude *= persistence;
+        frequency *= lacunarity;
+    }
+
+    *dx = total_dx / maxValue;
+    *dy = total_dy / maxValue;
+    return total / maxValue;
+}
+
+float cnoise3_ctx(const rs_noise* ctx, float x, float y, float z, int octaves, float persistence, float lacunarity) {
     float total = 0;
     float frequency = 1.0;
     float amplitude = 1.0;
     float maxValue = 0; // Used to normalize the result
 
     for (int i = 0; i < octaves; i++) {
-        total += noise3(x * frequency, y * frequency, z * frequency) * amplitude;
+        total += noise3_ctx(ctx, x * frequency, y * frequency, z * frequency) * amplitude;
         maxValue += amplitude;
         amplitude *= persistence;
         frequency *= lacunarity;
@@ -555,3 +720,86 @@ float cnoise3(float x, float y, float z, int octaves, float persistence, float l
 
     return total / maxValue; // Normalize to [0, 1]
 }
+
+//---------------------------------------------------------------------
+// Seeded contexts
+
+void rs_noise_init( rs_noise* ctx, uint64_t seed )
+{
+    if (seed == 0) {
+        *ctx = reference_noise;
+        return;
+    }
+
+    // Fisher-Yates shuffle of 0..255, repeated like the reference table
+    rs_rng rng = rs_make_rng(seed, 0);
+    ctx->seed = seed;
+    for (int i = 0; i < 256; i++) {
+        ctx->perm[i] = (unsigned char)i;
+    }
+    for (int i = 255; i > 0; i--) {
+        int j = (int)rs_rng_below(&rng, (uint32_t)i + 1);
+        unsigned char t = ctx->perm[i];
+        ctx->perm[i] = ctx->perm[j];
+        ctx->perm[j] = t;
+    }
+    memcpy(ctx->perm + 256, ctx->perm, 256);
+    memset(ctx->perm + 512, 0, 3);
+}
+
+rs_noise* rs_make_noise( uint64_t seed )
+{
+    rs_noise* ctx = malloc(sizeof(rs_noise));
+    rs_noise_init(ctx, seed);
+    return ctx;
+}
+
+void rs_free_noise( rs_noise* ctx )
+{
+    free(ctx);
+}
+
+const rs_noise* rs_default_noise( void )
+{
+    return &reference_noise;
+}
+
+//---------------------------------------------------------------------
+// The original entry points use the reference table
+
+float noise1( float x ) { return noise1_ctx( &reference_noise, x ); }
+float noise2( float x, float y ) { return noise2_ctx( &reference_noise, x, y ); }
+float noise3( float x, float y, float z ) { return noise3_ctx( &reference_noise, x, y, z ); }
+float noise4( float x, float y, float z, float w ) { return noise4_ctx( &reference_noise, x, y, z, w ); }
+
+float pnoise1( float x, int px ) { return pnoise1_ctx( &reference_noise, x, px ); }
+float pnoise2( float x, float y, int px, int py ) { return pnoise2_ctx( &reference_noise, x, y, px, py ); }
+float pnoise3( float x, float y, float z, int px, int py, int pz )
+{
+    return pnoise3_ctx( &reference_noise, x, y, z, px, py, pz );
+}
+float pnoise4( float x, float y, float z, float w, int px, int py, int pz, int pw )
+{
+    return pnoise4_ctx( &reference_noise, x, y, z, w, px, py, pz, pw );
+}
+
+float cnoise2(float x, float y, int octaves, float persistence, float lacunarity) {
+    return cnoise2_ctx(&reference_noise, x, y, octaves, persistence, lacunarity);
+}
+
+float cnoise3(float x, float y, float z, int octaves, float persistence, float lacunarity) {
+    return cnoise3_ctx(&reference_noise, x, y, z, octaves, persistence, lacunarity);
+}
+
+float cnoise2_filtered(float x, float y, float footprint, int octaves, float persistence, float lacunarity) {
+    return cnoise2_filtered_ctx(&reference_noise, x, y, footprint, octaves, persistence, lacunarity);
+}
+
+float noise2_deriv( float x, float y, float* dx, float* dy )
+{
+    return noise2_deriv_ctx( &reference_noise, x, y, dx, dy );
+}
+
+float cnoise2_deriv(float x, float y, int octaves, float persistence, float lacunarity, float* dx, float* dy) {
+    return cnoise2_deriv_ctx(&reference_noise, x, y, octaves, persistence, lacunarity, dx, dy);
+}
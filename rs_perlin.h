@@ -28,6 +28,22 @@
  *
  */
  
+#include <stdint.h>
+
+/** Noise context, a permutation table of its own. Seed 0 is the fixed
+ *  reference table the functions without a context use. A context isn't
+ *  written after rs_noise_init, so threads can share one.
+ */
+typedef struct rs_noise {
+    uint64_t seed;
+    unsigned char perm[512 + 3];
+} rs_noise;
+
+extern void rs_noise_init( rs_noise* ctx, uint64_t seed );
+extern rs_noise* rs_make_noise( uint64_t seed );
+extern void rs_free_noise( rs_noise* ctx );
+extern const rs_noise* rs_default_noise( void );
+
 /** 1D, 2D, 3D and 4D float Perlin noise
  */
 extern float noise1( float x );
@@ -44,4 +60,83 @@ extern float pnoise4( float x, float y, float z, float w, int px, int py, int pz
 
 extern float cnoise2(float x, float y, int octaves, float persistence, float lacunarity);
 extern float cnoise3(float x, float y, float z, int octaves, float persistence, float lacunarity);
+
+/** Batch versions of the above, out[i] is the noise at (x[i], y[i]) or
+ *  (x[i], y[i], z[i]). Vectorized with AVX2 or AVX-512 when the CPU has it.
+ */
+extern void noise2_batch(const float* x, const float* y, float* out, int n);
+extern void noise3_batch(const float* x, const float* y, const float* z, float* out, int n);
+extern void cnoise2_batch(const float* x, const float* y, float* out, int n, int octaves, float persistence, float lacunarity);
+extern void cnoise3_batch(const float* x, const float* y, const float* z, float* out, int n, int octaves, float persistence, float lacunarity);
+
+/** 2D noise and fBm with their analytic gradient, *dx and *dy are the
+ *  derivatives of the returned value in x and y. Values match noise2 and
+ *  cnoise2. The batch form writes the gradient to dx[i] and dy[i].
+ */
+extern float noise2_deriv( float x, float y, float* dx, float* dy );
+extern float cnoise2_deriv(float x, float y, int octaves, float persistence, float lacunarity, float* dx, float* dy);
+extern void cnoise2_deriv_batch(const float* x, const float* y, float* out, float* dx, float* dy, int n,
+                                int octaves, float persistence, float lacunarity);
+
+/** Band-limited cnoise2 for points sampled footprint noise units apart.
+ *  Octaves above RS_FBM_FADE_START cycles per sample fade out and are
+ *  skipped from RS_FBM_NYQUIST on, so coarse previews don't pay for or
+ *  alias on detail they can't show. The normalization is still that of
+ *  all the octaves, a footprint of 0 gives cnoise2.
+ */
+#define RS_FBM_FADE_START (0.25f)
+#define RS_FBM_NYQUIST    (0.5f)
+
+extern float fbm_octave_weight(float frequency, float footprint);
+
+/** The octaves of such an fBm that contribute, with their frequency and
+ *  weighted amplitude as the scalar loop computes them, for batch kernels.
+ *  Returns 0 when more than RS_MAX_PLAN_OCTAVES octaves contribute.
+ */
+#define RS_MAX_PLAN_OCTAVES (32)
+
+typedef struct {
+    int count;
+    float frequency[RS_MAX_PLAN_OCTAVES];
+    float amplitude[RS_MAX_PLAN_OCTAVES];
+    float max_value;
+} rs_octave_plan;
+
+extern int rs_make_octave_plan(rs_octave_plan* plan, float footprint, int octaves, float persistence, float lacunarity);
+extern float cnoise2_filtered(float x, float y, float footprint, int octaves, float persistence, float lacunarity);
+extern void cnoise2_filtered_batch(const float* x, const float* y, float* out, int n, float footprint,
+                                   int octaves, float persistence, float lacunarity);
+
+/** The above with an explicit context
+ */
+extern float noise1_ctx( const rs_noise* ctx, float x );
+extern float noise2_ctx( const rs_noise* ctx, float x, float y );
+extern float noise3_ctx( const rs_noise* ctx, float x, float y, float z );
+extern float noise4_ctx( const rs_noise* ctx, float x, float y, float z, float w );
+
+extern float pnoise1_ctx( const rs_noise* ctx, float x, int px );
+extern float pnoise2_ctx( const rs_noise* ctx, float x, float y, int px, int py );
+extern float pnoise3_ctx( const rs_noise* ctx, float x, float y, float z, int px, int py, int pz );
+extern float pnoise4_ctx( const rs_noise* ctx, float x, float y, float z, float w, int px, int py, int pz, int pw );
+
+extern float cnoise2_ctx(const rs_noise* ctx, float x, float y, int octaves, float persistence, float lacunarity);
+extern float cnoise3_ctx(const rs_noise* ctx, float x, float y, float z, int octaves, float persistence, float lacunarity);
+
+extern float noise2_deriv_ctx( const rs_noise* ctx, float x, float y, float* dx, float* dy );
+extern float cnoise2_deriv_ctx(const rs_noise* ctx, float x, float y, int octaves, float persistence, float lacunarity,
+                               float* dx, float* dy);
+
+extern void noise2_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, int n);
+extern void noise3_batch_ctx(const rs_noise* ctx, const float* x, const float* y, const float* z, float* out, int n);
+extern void cnoise2_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, int n,
+                              int octaves, float persistence, float lacunarity);
+extern void cnoise3_batch_ctx(const rs_noise* ctx, const float* x, const float* y, const float* z, float* out, int n,
+                              int octaves, float persistence, float lacunarity);
+extern void cnoise2_deriv_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, float* dx, float* dy,
+                                    int n, int octaves, float persistence, float lacunarity);
+extern float cnoise2_filtered_ctx(const rs_noise* ctx, float x, float y, float footprint,
+                                  int octaves, float persistence, float lacunarity);
+extern void cnoise2_filtered_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, int n,
+                                       float footprint, int octaves, float persistence, float lacunarity);
+
 #endif
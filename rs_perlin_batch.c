@@ -0,0 +1,730 @@
+// Batch evaluation of the noise1234 Perlin noise in rs_perlin.c.
+//
+// Each kernel evaluates 8 (AVX2) or 16 (AVX-512) points at a time with the
+// same float operations, in the same order, as the scalar code, so results
+// match noise2/noise3/cnoise2/cnoise3 to within float rounding (bit for bit
+// in practice). Gradient selection is done with blends and sign flips
+// instead of branches, and permutation lookups are 32-bit gathers from the
+// byte table with the upper bytes masked off.
+//
+// The instruction set is picked at run time, the whole file builds without
+// any -m flags. Points past the last full vector go through the scalar code.
+
+#include <immintrin.h>
+#include "rs_perlin.h"
+
+#define AVX2 __attribute__((target("avx2")))
+#define AVX512 __attribute__((target("avx512f")))
+
+//---------------------------------------------------------------------
+// AVX2, 8 lanes
+
+AVX2 static inline __m256i floor8(__m256 x) {
+    // FASTFLOOR: trunc(x) when trunc(x) < x, otherwise trunc(x) - 1
+    __m256i t = _mm256_cvttps_epi32(x);
+    __m256i lt = _mm256_castps_si256(_mm256_cmp_ps(_mm256_cvtepi32_ps(t), x, _CMP_LT_OQ));
+    return _mm256_add_epi32(t, _mm256_andnot_si256(lt, _mm256_set1_epi32(-1)));
+}
+
+AVX2 static inline __m256i perm8(const unsigned char* p, __m256i i) {
+    return _mm256_and_si256(_mm256_i32gather_epi32((const int*)p, i, 1), _mm256_set1_epi32(0xff));
+}
+
+AVX2 static inline __m256 fade8(__m256 t) {
+    __m256 t3 = _mm256_mul_ps(_mm256_mul_ps(t, t), t);
+    __m256 inner = _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6)), _mm256_set1_ps(15));
+    inner = _mm256_add_ps(_mm256_mul_ps(t, inner), _mm256_set1_ps(10));
+    return _mm256_mul_ps(t3, inner);
+}
+
+AVX2 static inline __m256 lerp8(__m256 t, __m256 a, __m256 b) {
+    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+// xor mask that flips the sign of a lane when the given hash bit is set
+AVX2 static inline __m256 sign8(__m256i h, int bit) {
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1 << bit)), 31 - bit));
+}
+
+AVX2 static inline __m256 grad2_8(__m256i hash, __m256 x, __m256 y) {
+    __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(7));
+    __m256 lt4 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(h, _mm256_set1_epi32(4)), _mm256_setzero_si256()));
+    __m256 u = _mm256_blendv_ps(y, x, lt4);
+    __m256 v = _mm256_blendv_ps(x, y, lt4);
+    v = _mm256_add_ps(v, v);
+    return _mm256_add_ps(_mm256_xor_ps(u, sign8(h, 0)), _mm256_xor_ps(v, sign8(h, 1)));
+}
+
+AVX2 static inline __m256 grad3_8(__m256i hash, __m256 x, __m256 y, __m256 z) {
+    __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+    __m256 lt8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+    __m256 lt4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    // h == 12 || h == 14
+    __m256 hx = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(h, _mm256_set1_epi32(13)), _mm256_set1_epi32(12)));
+    __m256 u = _mm256_blendv_ps(y, x, lt8);
+    __m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, hx), y, lt4);
+    return _mm256_add_ps(_mm256_xor_ps(u, sign8(h, 0)), _mm256_xor_ps(v, sign8(h, 1)));
+}
+
+AVX2 static __m256 noise2_8(const unsigned char* p, __m256 x, __m256 y) {
+    __m256i mask = _mm256_set1_epi32(0xff);
+    __m256i one = _mm256_set1_epi32(1);
+    __m256 onef = _mm256_set1_ps(1.0f);
+
+    __m256i ix0 = floor8(x);
+    __m256i iy0 = floor8(y);
+    __m256 fx0 = _mm256_sub_ps(x, _mm256_cvtepi32_ps(ix0));
+    __m256 fy0 = _mm256_sub_ps(y, _mm256_cvtepi32_ps(iy0));
+    __m256 fx1 = _mm256_sub_ps(fx0, onef);
+    __m256 fy1 = _mm256_sub_ps(fy0, onef);
+    __m256i ix1 = _mm256_and_si256(_mm256_add_epi32(ix0, one), mask);
+    __m256i iy1 = _mm256_and_si256(_mm256_add_epi32(iy0, one), mask);
+    ix0 = _mm256_and_si256(ix0, mask);
+    iy0 = _mm256_and_si256(iy0, mask);
+
+    __m256 t = fade8(fy0);
+    __m256 s = fade8(fx0);
+
+    __m256i py0 = perm8(p, iy0);
+    __m256i py1 = perm8(p, iy1);
+
+    __m256 nx0 = grad2_8(perm8(p, _mm256_add_epi32(ix0, py0)), fx0, fy0);
+    __m256 nx1 = grad2_8(perm8(p, _mm256_add_epi32(ix0, py1)), fx0, fy1);
+    __m256 n0 = lerp8(t, nx0, nx1);
+
+    nx0 = grad2_8(perm8(p, _mm256_add_epi32(ix1, py0)), fx1, fy0);
+    nx1 = grad2_8(perm8(p, _mm256_add_epi32(ix1, py1)), fx1, fy1);
+    __m256 n1 = lerp8(t, nx0, nx1);
+
+    return _mm256_mul_ps(_mm256_set1_ps(0.507f), lerp8(s, n0, n1));
+}
+
+AVX2 static __m256 noise3_8(const unsigned char* p, __m256 x, __m256 y, __m256 z) {
+    __m256i mask = _mm256_set1_epi32(0xff);
+    __m256i one = _mm256_set1_epi32(1);
+    __m256 onef = _mm256_set1_ps(1.0f);
+
+    __m256i ix0 = floor8(x);
+    __m256i iy0 = floor8(y);
+    __m256i iz0 = floor8(z);
+    __m256 fx0 = _mm256_sub_ps(x, _mm256_cvtepi32_ps(ix0));
+    __m256 fy0 = _mm256_sub_ps(y, _mm256_cvtepi32_ps(iy0));
+    __m256 fz0 = _mm256_sub_ps(z, _mm256_cvtepi32_ps(iz0));
+    __m256 fx1 = _mm256_sub_ps(fx0, onef);
+    __m256 fy1 = _mm256_sub_ps(fy0, onef);
+    __m256 fz1 = _mm256_sub_ps(fz0, onef);
+    __m256i ix1 = _mm256_and_si256(_mm256_add_epi32(ix0, one), mask);
+    __m256i iy1 = _mm256_and_si256(_mm256_add_epi32(iy0, one), mask);
+    __m256i iz1 = _mm256_and_si256(_mm256_add_epi32(iz0, one), mask);
+    ix0 = _mm256_and_si256(ix0, mask);
+    iy0 = _mm256_and_si256(iy0, mask);
+    iz0 = _mm256_and_si256(iz0, mask);
+
+    __m256 r = fade8(fz0);
+    __m256 t = fade8(fy0);
+    __m256 s = fade8(fx0);
+
+    __m256i pz0 = perm8(p, iz0);
+    __m256i pz1 = perm8(p, iz1);
+    __m256i py00 = perm8(p, _mm256_add_epi32(iy0, pz0));
+    __m256i py01 = perm8(p, _mm256_add_epi32(iy0, pz1));
+    __m256i py10 = perm8(p, _mm256_add_epi32(iy1, pz0));
+    __m256i py11 = perm8(p, _mm256_add_epi32(iy1, pz1));
+
+    __m256 nxy0 = grad3_8(perm8(p, _mm256_add_epi32(ix0, py00)), fx0, fy0, fz0);
+    __m256 nxy1 = grad3_8(perm8(p, _mm256_add_epi32(ix0, py01)), fx0, fy0, fz1);
+    __m256 nx0 = lerp8(r, nxy0, nxy1);
+
+    nxy0 = grad3_8(perm8(p, _mm256_add_epi32(ix0, py10)), fx0, fy1, fz0);
+    nxy1 = grad3_8(perm8(p, _mm256_add_epi32(ix0, py11)), fx0, fy1, fz1);
+    __m256 nx1 = lerp8(r, nxy0, nxy1);
+
+    __m256 n0 = lerp8(t, nx0, nx1);
+
+    nxy0 = grad3_8(perm8(p, _mm256_add_epi32(ix1, py00)), fx1, fy0, fz0);
+    nxy1 = grad3_8(perm8(p, _mm256_add_epi32(ix1, py01)), fx1, fy0, fz1);
+    nx0 = lerp8(r, nxy0, nxy1);
+
+    nxy0 = grad3_8(perm8(p, _mm256_add_epi32(ix1, py10)), fx1, fy1, fz0);
+    nxy1 = grad3_8(perm8(p, _mm256_add_epi32(ix1, py11)), fx1, fy1, fz1);
+    nx1 = lerp8(r, nxy0, nxy1);
+
+    __m256 n1 = lerp8(t, nx0, nx1);
+
+    return _mm256_mul_ps(_mm256_set1_ps(0.936f), lerp8(s, n0, n1));
+}
+
+AVX2 static int noise2_batch_avx2(const unsigned char* p, const float* x, const float* y, float* out, int n,
+                                  int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 total = _mm256_setzero_ps();
+        float frequency = 1.0;
+        float amplitude = 1.0;
+        float maxValue = 0;
+        for (int o = 0; o < octaves; o++) {
+            __m256 f = _mm256_set1_ps(frequency);
+            __m256 v = noise2_8(p, _mm256_mul_ps(vx, f), _mm256_mul_ps(vy, f));
+            total = _mm256_add_ps(total, _mm256_mul_ps(v, _mm256_set1_ps(amplitude)));
+            maxValue += amplitude;
+            amplitude *= persistence;
+            frequency *= lacunarity;
+        }
+        _mm256_storeu_ps(out + i, _mm256_div_ps(total, _mm256_set1_ps(maxValue)));
+    }
+    return i;
+}
+
+AVX2 static int noise3_batch_avx2(const unsigned char* p, const float* x, const float* y, const float* z, float* out, int n,
+                                  int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 vz = _mm256_loadu_ps(z + i);
+        __m256 total = _mm256_setzero_ps();
+        float frequency = 1.0;
+        float amplitude = 1.0;
+        float maxValue = 0;
+        for (int o = 0; o < octaves; o++) {
+            __m256 f = _mm256_set1_ps(frequency);
+            __m256 v = noise3_8(p, _mm256_mul_ps(vx, f), _mm256_mul_ps(vy, f), _mm256_mul_ps(vz, f));
+            total = _mm256_add_ps(total, _mm256_mul_ps(v, _mm256_set1_ps(amplitude)));
+            maxValue += amplitude;
+            amplitude *= persistence;
+            frequency *= lacunarity;
+        }
+        _mm256_storeu_ps(out + i, _mm256_div_ps(total, _mm256_set1_ps(maxValue)));
+    }
+    return i;
+}
+
+// fBm over the octaves of a plan
+AVX2 static int noise2_filtered_batch_avx2(const unsigned char* p, const float* x, const float* y, float* out, int n,
+                                           const rs_octave_plan* plan) {
+    int i = 0;
+    __m256 m = _mm256_set1_ps(plan->max_value);
+    for (; i + 8 <= n; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 total = _mm256_setzero_ps();
+        for (int o = 0; o < plan->count; o++) {
+            __m256 f = _mm256_set1_ps(plan->frequency[o]);
+            __m256 v = noise2_8(p, _mm256_mul_ps(vx, f), _mm256_mul_ps(vy, f));
+            total = _mm256_add_ps(total, _mm256_mul_ps(v, _mm256_set1_ps(plan->amplitude[o])));
+        }
+        _mm256_storeu_ps(out + i, _mm256_div_ps(total, m));
+    }
+    return i;
+}
+
+AVX2 static inline __m256 dfade8(__m256 t) {
+    __m256 t2 = _mm256_mul_ps(t, t);
+    __m256 inner = _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(30)), _mm256_set1_ps(60));
+    inner = _mm256_add_ps(_mm256_mul_ps(t, inner), _mm256_set1_ps(30));
+    return _mm256_mul_ps(t2, inner);
+}
+
+// the gradient grad2_8() dots with, as in grad2_coeffs()
+AVX2 static inline void grad2_coeffs8(__m256i hash, __m256* gx, __m256* gy) {
+    __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(7));
+    __m256 lt4 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(h, _mm256_set1_epi32(4)), _mm256_setzero_si256()));
+    __m256 u = _mm256_xor_ps(_mm256_set1_ps(1.0f), sign8(h, 0));
+    __m256 v = _mm256_xor_ps(_mm256_set1_ps(2.0f), sign8(h, 1));
+    *gx = _mm256_blendv_ps(v, u, lt4);
+    *gy = _mm256_blendv_ps(u, v, lt4);
+}
+
+AVX2 static __m256 noise2_deriv_8(const unsigned char* p, __m256 x, __m256 y, __m256* dx, __m256* dy) {
+    __m256i mask = _mm256_set1_epi32(0xff);
+    __m256i one = _mm256_set1_epi32(1);
+    __m256 onef = _mm256_set1_ps(1.0f);
+    __m256 k = _mm256_set1_ps(0.507f);
+
+    __m256i ix0 = floor8(x);
+    __m256i iy0 = floor8(y);
+    __m256 fx0 = _mm256_sub_ps(x, _mm256_cvtepi32_ps(ix0));
+    __m256 fy0 = _mm256_sub_ps(y, _mm256_cvtepi32_ps(iy0));
+    __m256 fx1 = _mm256_sub_ps(fx0, onef);
+    __m256 fy1 = _mm256_sub_ps(fy0, onef);
+    __m256i ix1 = _mm256_and_si256(_mm256_add_epi32(ix0, one), mask);
+    __m256i iy1 = _mm256_and_si256(_mm256_add_epi32(iy0, one), mask);
+    ix0 = _mm256_and_si256(ix0, mask);
+    iy0 = _mm256_and_si256(iy0, mask);
+
+    __m256 t = fade8(fy0);
+    __m256 s = fade8(fx0);
+    __m256 dt = dfade8(fy0);
+    __m256 ds = dfade8(fx0);
+
+    __m256i py0 = perm8(p, iy0);
+    __m256i py1 = perm8(p, iy1);
+    __m256i h00 = perm8(p, _mm256_add_epi32(ix0, py0));
+    __m256i h01 = perm8(p, _mm256_add_epi32(ix0, py1));
+    __m256i h10 = perm8(p, _mm256_add_epi32(ix1, py0));
+    __m256i h11 = perm8(p, _mm256_add_epi32(ix1, py1));
+
+    __m256 g00 = grad2_8(h00, fx0, fy0);
+    __m256 g01 = grad2_8(h01, fx0, fy1);
+    __m256 n0 = lerp8(t, g00, g01);
+    __m256 g10 = grad2_8(h10, fx1, fy0);
+    __m256 g11 = grad2_8(h11, fx1, fy1);
+    __m256 n1 = lerp8(t, g10, g11);
+
+    __m256 ax00, ay00, ax01, ay01, ax10, ay10, ax11, ay11;
+    grad2_coeffs8(h00, &ax00, &ay00);
+    grad2_coeffs8(h01, &ax01, &ay01);
+    grad2_coeffs8(h10, &ax10, &ay10);
+    grad2_coeffs8(h11, &ax11, &ay11);
+
+    __m256 n0x = lerp8(t, ax00, ax01);
+    __m256 n0y = _mm256_add_ps(lerp8(t, ay00, ay01), _mm256_mul_ps(dt, _mm256_sub_ps(g01, g00)));
+    __m256 n1x = lerp8(t, ax10, ax11);
+    __m256 n1y = _mm256_add_ps(lerp8(t, ay10, ay11), _mm256_mul_ps(dt, _mm256_sub_ps(g11, g10)));
+
+    *dx = _mm256_mul_ps(k, _mm256_add_ps(lerp8(s, n0x, n1x), _mm256_mul_ps(ds, _mm256_sub_ps(n1, n0))));
+    *dy = _mm256_mul_ps(k, lerp8(s, n0y, n1y));
+    return _mm256_mul_ps(k, lerp8(s, n0, n1));
+}
+
+AVX2 static int noise2_deriv_batch_avx2(const unsigned char* p, const float* x, const float* y, float* out,
+                                        float* dx, float* dy, int n, int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 total = _mm256_setzero_ps();
+        __m256 total_dx = _mm256_setzero_ps();
+        __m256 total_dy = _mm256_setzero_ps();
+        float frequency = 1.0;
+        float amplitude = 1.0;
+        float maxValue = 0;
+        for (int o = 0; o < octaves; o++) {
+            __m256 f = _mm256_set1_ps(frequency);
+            __m256 af = _mm256_set1_ps(amplitude * frequency);
+            __m256 nx, ny;
+            __m256 v = noise2_deriv_8(p, _mm256_mul_ps(vx, f), _mm256_mul_ps(vy, f), &nx, &ny);
+            total = _mm256_add_ps(total, _mm256_mul_ps(v, _mm256_set1_ps(amplitude)));
+            total_dx = _mm256_add_ps(total_dx, _mm256_mul_ps(nx, af));
+            total_dy = _mm256_add_ps(total_dy, _mm256_mul_ps(ny, af));
+            maxValue += amplitude;
+            amplitude *= persistence;
+            frequency *= lacunarity;
+        }
+        __m256 m = _mm256_set1_ps(maxValue);
+        _mm256_storeu_ps(out + i, _mm256_div_ps(total, m));
+        _mm256_storeu_ps(dx + i, _mm256_div_ps(total_dx, m));
+        _mm256_storeu_ps(dy + i, _mm256_div_ps(total_dy, m));
+    }
+    return i;
+}
+
+//---------------------------------------------------------------------
+// AVX-512, 16 lanes
+
+AVX512 static inline __m512i floor16(__m512 x) {
+    __m512i t = _mm512_cvttps_epi32(x);
+    __mmask16 lt = _mm512_cmp_ps_mask(_mm512_cvtepi32_ps(t), x, _CMP_LT_OQ);
+    return _mm512_mask_sub_epi32(t, ~lt, t, _mm512_set1_epi32(1));
+}
+
+AVX512 static inline __m512i perm16(const unsigned char* p, __m512i i) {
+    return _mm512_and_si512(_mm512_i32gather_epi32(i, (const void*)p, 1), _mm512_set1_epi32(0xff));
+}
+
+AVX512 static inline __m512 fade16(__m512 t) {
+    __m512 t3 = _mm512_mul_ps(_mm512_mul_ps(t, t), t);
+    __m512 inner = _mm512_sub_ps(_mm512_mul_ps(t, _mm512_set1_ps(6)), _mm512_set1_ps(15));
+    inner = _mm512_add_ps(_mm512_mul_ps(t, inner), _mm512_set1_ps(10));
+    return _mm512_mul_ps(t3, inner);
+}
+
+AVX512 static inline __m512 lerp16(__m512 t, __m512 a, __m512 b) {
+    return _mm512_add_ps(a, _mm512_mul_ps(t, _mm512_sub_ps(b, a)));
+}
+
+AVX512 static inline __m512 flip16(__m512 v, __m512i h, int bit) {
+    __m512i sign = _mm512_slli_epi32(_mm512_and_si512(h, _mm512_set1_epi32(1 << bit)), 31 - bit);
+    return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(v), sign));
+}
+
+AVX512 static inline __m512 grad2_16(__m512i hash, __m512 x, __m512 y) {
+    __m512i h = _mm512_and_si512(hash, _mm512_set1_epi32(7));
+    __mmask16 ge4 = _mm512_test_epi32_mask(h, _mm512_set1_epi32(4));
+    __m512 u = _mm512_mask_blend_ps(ge4, x, y);
+    __m512 v = _mm512_mask_blend_ps(ge4, y, x);
+    v = _mm512_add_ps(v, v);
+    return _mm512_add_ps(flip16(u, h, 0), flip16(v, h, 1));
+}
+
+AVX512 static inline __m512 grad3_16(__m512i hash, __m512 x, __m512 y, __m512 z) {
+    __m512i h = _mm512_and_si512(hash, _mm512_set1_epi32(15));
+    __mmask16 lt8 = _mm512_cmplt_epi32_mask(h, _mm512_set1_epi32(8));
+    __mmask16 lt4 = _mm512_cmplt_epi32_mask(h, _mm512_set1_epi32(4));
+    __mmask16 hx = _mm512_cmpeq_epi32_mask(_mm512_and_si512(h, _mm512_set1_epi32(13)), _mm512_set1_epi32(12));
+    __m512 u = _mm512_mask_blend_ps(lt8, y, x);
+    __m512 v = _mm512_mask_blend_ps(lt4, _mm512_mask_blend_ps(hx, z, x), y);
+    return _mm512_add_ps(flip16(u, h, 0), flip16(v, h, 1));
+}
+
+AVX512 static __m512 noise2_16(const unsigned char* p, __m512 x, __m512 y) {
+    __m512i mask = _mm512_set1_epi32(0xff);
+    __m512i one = _mm512_set1_epi32(1);
+    __m512 onef = _mm512_set1_ps(1.0f);
+
+    __m512i ix0 = floor16(x);
+    __m512i iy0 = floor16(y);
+    __m512 fx0 = _mm512_sub_ps(x, _mm512_cvtepi32_ps(ix0));
+    __m512 fy0 = _mm512_sub_ps(y, _mm512_cvtepi32_ps(iy0));
+    __m512 fx1 = _mm512_sub_ps(fx0, onef);
+    __m512 fy1 = _mm512_sub_ps(fy0, onef);
+    __m512i ix1 = _mm512_and_si512(_mm512_add_epi32(ix0, one), mask);
+    __m512i iy1 = _mm512_and_si512(_mm512_add_epi32(iy0, one), mask);
+    ix0 = _mm512_and_si512(ix0, mask);
+    iy0 = _mm512_and_si512(iy0, mask);
+
+    __m512 t = fade16(fy0);
+    __m512 s = fade16(fx0);
+
+    __m512i py0 = perm16(p, iy0);
+    __m512i py1 = perm16(p, iy1);
+
+    __m512 nx0 = grad2_16(perm16(p, _mm512_add_epi32(ix0, py0)), fx0, fy0);
+    __m512 nx1 = grad2_16(perm16(p, _mm512_add_epi32(ix0, py1)), fx0, fy1);
+    __m512 n0 = lerp16(t, nx0, nx1);
+
+    nx0 = grad2_16(perm16(p, _mm512_add_epi32(ix1, py0)), fx1, fy0);
+    nx1 = grad2_16(perm16(p, _mm512_add_epi32(ix1, py1)), fx1, fy1);
+    __m512 n1 = lerp16(t, nx0, nx1);
+
+    return _mm512_mul_ps(_mm512_set1_ps(0.507f), lerp16(s, n0, n1));
+}
+
+AVX512 static __m512 noise3_16(const unsigned char* p, __m512 x, __m512 y, __m512 z) {
+    __m512i mask = _mm512_set1_epi32(0xff);
+    __m512i one = _mm512_set1_epi32(1);
+    __m512 onef = _mm512_set1_ps(1.0f);
+
+    __m512i ix0 = floor16(x);
+    __m512i iy0 = floor16(y);
+    __m512i iz0 = floor16(z);
+    __m512 fx0 = _mm512_sub_ps(x, _mm512_cvtepi32_ps(ix0));
+    __m512 fy0 = _mm512_sub_ps(y, _mm512_cvtepi32_ps(iy0));
+    __m512 fz0 = _mm512_sub_ps(z, _mm512_cvtepi32_ps(iz0));
+    __m512 fx1 = _mm512_sub_ps(fx0, onef);
+    __m512 fy1 = _mm512_sub_ps(fy0, onef);
+    __m512 fz1 = _mm512_sub_ps(fz0, onef);
+    __m512i ix1 = _mm512_and_si512(_mm512_add_epi32(ix0, one), mask);
+    __m512i iy1 = _mm512_and_si512(_mm512_add_epi32(iy0, one), mask);
+    __m512i iz1 = _mm512_and_si512(_mm512_add_epi32(iz0, one), mask);
+    ix0 = _mm512_and_si512(ix0, mask);
+    iy0 = _mm512_and_si512(iy0, mask);
+    iz0 = _mm512_and_si512(iz0, mask);
+
+    __m512 r = fade16(fz0);
+    __m512 t = fade16(fy0);
+    __m512 s = fade16(fx0);
+
+    __m512i pz0 = perm16(p, iz0);
+    __m512i pz1 = perm16(p, iz1);
+    __m512i py00 = perm16(p, _mm512_add_epi32(iy0, pz0));
+    __m512i py01 = perm16(p, _mm512_add_epi32(iy0, pz1));
+    __m512i py10 = perm16(p, _mm512_add_epi32(iy1, pz0));
+    __m512i py11 = perm16(p, _mm512_add_epi32(iy1, pz1));
+
+    __m512 nxy0 = grad3_16(perm16(p, _mm512_add_epi32(ix0, py00)), fx0, fy0, fz0);
+    __m512 nxy1 = grad3_16(perm16(p, _mm512_add_epi32(ix0, py01)), fx0, fy0, fz1);
+    __m512 nx0 = lerp16(r, nxy0, nxy1);
+
+    nxy0 = grad3_16(perm16(p, _mm512_add_epi32(ix0, py10)), fx0, fy1, fz0);
+    nxy1 = grad3_16(perm16(p, _mm512_add_epi32(ix0, py11)), fx0, fy1, fz1);
+    __m512 nx1 = lerp16(r, nxy0, nxy1);
+
+    __m512 n0 = lerp16(t, nx0, nx1);
+
+    nxy0 = grad3_16(perm16(p, _mm512_add_epi32(ix1, py00)), fx1, fy0, fz0);
+    nxy1 = grad3_16(perm16(p, _mm512_add_epi32(ix1, py01)), fx1, fy0, fz1);
+    nx0 = lerp16(r, nxy0, nxy1);
+
+    nxy0 = grad3_16(perm16(p, _mm512_add_epi32(ix1, py10)), fx1, fy1, fz0);
+    nxy1 = grad3_16(perm16(p, _mm512_add_epi32(ix1, py11)), fx1, fy1, fz1);
+    nx1 = lerp16(r, nxy0, nxy1);
+
+    __m512 n1 = lerp16(t, nx0, nx1);
+
+    return _mm512_mul_ps(_mm512_set1_ps(0.936f), lerp16(s, n0, n1));
+}
+
+AVX512 static int noise2_batch_avx512(const unsigned char* p, const float* x, const float* y, float* out, int n,
+                                      int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 vx = _mm512_loadu_ps(x + i);
+        __m512 vy = _mm512_loadu_ps(y + i);
+        __m512 total = _mm512_setzero_ps();
+        float frequency = 1.0;
+        float amplitude = 1.0;
+        float maxValue = 0;
+        for (int o = 0; o < octaves; o++) {
+            __m512 f = _mm512_set1_ps(frequency);
+            __m512 v = noise2_16(p, _mm512_mul_ps(vx, f), _mm512_mul_ps(vy, f));
+            total = _mm512_add_ps(total, _mm512_mul_ps(v, _mm512_set1_ps(amplitude)));
+            maxValue += amplitude;
+            amplitude *= persistence;
+            frequency *= lacunarity;
+        }
+        _mm512_storeu_ps(out + i, _mm512_div_ps(total, _mm512_set1_ps(maxValue)));
+    }
+    return i;
+}
+
+AVX512 static int noise3_batch_avx512(const unsigned char* p, const float* x, const float* y, const float* z, float* out, int n,
+                                      int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 vx = _mm512_loadu_ps(x + i);
+        __m512 vy = _mm512_loadu_ps(y + i);
+        __m512 vz = _mm512_loadu_ps(z + i);
+        __m512 total = _mm512_setzero_ps();
+        float frequency = 1.0;
+        float amplitude = 1.0;
+        float maxValue = 0;
+        for (int o = 0; o < octaves; o++) {
+            __m512 f = _mm512_set1_ps(frequency);
+            __m512 v = noise3_16(p, _mm512_mul_ps(vx, f), _mm512_mul_ps(vy, f), _mm512_mul_ps(vz, f));
+            total = _mm512_add_ps(total, _mm512_mul_ps(v, _mm512_set1_ps(amplitude)));
+            maxValue += amplitude;
+            amplitude *= persistence;
+            frequency *= lacunarity;
+        }
+        _mm512_storeu_ps(out + i, _mm512_div_ps(total, _mm512_set1_ps(maxValue)));
+    }
+    return i;
+}
+
+AVX512 static int noise2_filtered_batch_avx512(const unsigned char* p, const float* x, const float* y, float* out, int n,
+                                               const rs_octave_plan* plan) {
+    int i = 0;
+    __m512 m = _mm512_set1_ps(plan->max_value);
+    for (; i + 16 <= n; i += 16) {
+        __m512 vx = _mm512_loadu_ps(x + i);
+        __m512 vy = _mm512_loadu_ps(y + i);
+        __m512 total = _mm512_setzero_ps();
+        for (int o = 0; o < plan->count; o++) {
+            __m512 f = _mm512_set1_ps(plan->frequency[o]);
+            __m512 v = noise2_16(p, _mm512_mul_ps(vx, f), _mm512_mul_ps(vy, f));
+            total = _mm512_add_ps(total, _mm512_mul_ps(v, _mm512_set1_ps(plan->amplitude[o])));
+        }
+        _mm512_storeu_ps(out + i, _mm512_div_ps(total, m));
+    }
+    return i;
+}
+
+AVX512 static inline __m512 dfade16(__m512 t) {
+    __m512 t2 = _mm512_mul_ps(t, t);
+    __m512 inner = _mm512_sub_ps(_mm512_mul_ps(t, _mm512_set1_ps(30)), _mm512_set1_ps(60));
+    inner = _mm512_add_ps(_mm512_mul_ps(t, inner), _mm512_set1_ps(30));
+    return _mm512_mul_ps(t2, inner);
+}
+
+AVX512 static inline void grad2_coeffs16(__m512i hash, __m512* gx, __m512* gy) {
+    __m512i h = _mm512_and_si512(hash, _mm512_set1_epi32(7));
+    __mmask16 ge4 = _mm512_test_epi32_mask(h, _mm512_set1_epi32(4));
+    __m512 u = flip16(_mm512_set1_ps(1.0f), h, 0);
+    __m512 v = flip16(_mm512_set1_ps(2.0f), h, 1);
+    *gx = _mm512_mask_blend_ps(ge4, u, v);
+    *gy = _mm512_mask_blend_ps(ge4, v, u);
+}
+
+AVX512 static __m512 noise2_deriv_16(const unsigned char* p, __m512 x, __m512 y, __m512* dx, __m512* dy) {
+    __m512i mask = _mm512_set1_epi32(0xff);
+    __m512i one = _mm512_set1_epi32(1);
+    __m512 onef = _mm512_set1_ps(1.0f);
+    __m512 k = _mm512_set1_ps(0.507f);
+
+    __m512i ix0 = floor16(x);
+    __m512i iy0 = floor16(y);
+    __m512 fx0 = _mm512_sub_ps(x, _mm512_cvtepi32_ps(ix0));
+    __m512 fy0 = _mm512_sub_ps(y, _mm512_cvtepi32_ps(iy0));
+    __m512 fx1 = _mm512_sub_ps(fx0, onef);
+    __m512 fy1 = _mm512_sub_ps(fy0, onef);
+    __m512i ix1 = _mm512_and_si512(_mm512_add_epi32(ix0, one), mask);
+    __m512i iy1 = _mm512_and_si512(_mm512_add_epi32(iy0, one), mask);
+    ix0 = _mm512_and_si512(ix0, mask);
+    iy0 = _mm512_and_si512(iy0, mask);
+
+    __m512 t = fade16(fy0);
+    __m512 s = fade16(fx0);
+    __m512 dt = dfade16(fy0);
+    __m512 ds = dfade16(fx0);
+
+    __m512i py0 = perm16(p, iy0);
+    __m512i py1 = perm16(p, iy1);
+    __m512i h00 = perm16(p, _mm512_add_epi32(ix0, py0));
+    __m512i h01 = perm16(p, _mm512_add_epi32(ix0, py1));
+    __m512i h10 = perm16(p, _mm512_add_epi32(ix1, py0));
+    __m512i h11 = perm16(p, _mm512_add_epi32(ix1, py1));
+
+    __m512 g00 = grad2_16(h00, fx0, fy0);
+    __m512 g01 = grad2_16(h01, fx0, fy1);
+    __m512 n0 = lerp16(t, g00, g01);
+    __m512 g10 = grad2_16(h10, fx1, fy0);
+    __m512 g11 = grad2_16(h11, fx1, fy1);
+    __m512 n1 = lerp16(t, g10, g11);
+
+    __m512 ax00, ay00, ax01, ay01, ax10, ay10, ax11, ay11;
+    grad2_coeffs16(h00, &ax00, &ay00);
+    grad2_coeffs16(h01, &ax01, &ay01);
+    grad2_coeffs16(h10, &ax10, &ay10);
+    grad2_coeffs16(h11, &ax11, &ay11);
+
+    __m512 n0x = lerp16(t, ax00, ax01);
+    __m512 n0y = _mm512_add_ps(lerp16(t, ay00, ay01), _mm512_mul_ps(dt, _mm512_sub_ps(g01, g00)));
+    __m512 n1x = lerp16(t, ax10, ax11);
+    __m512 n1y = _mm512_add_ps(lerp16(t, ay10, ay11), _mm512_mul_ps(dt, _mm512_sub_ps(g11, g10)));
+
+    *dx = _mm512_mul_ps(k, _mm512_add_ps(lerp16(s, n0x, n1x), _mm512_mul_ps(ds, _mm512_sub_ps(n1, n0))));
+    *dy = _mm512_mul_ps(k, lerp16(s, n0y, n1y));
+    return _mm512_mul_ps(k, lerp16(s, n0, n1));
+}
+
+AVX512 static int noise2_deriv_batch_avx512(const unsigned char* p, const float* x, const float* y, float* out,
+                                            float* dx, float* dy, int n, int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 vx = _mm512_loadu_ps(x + i);
+        __m512 vy = _mm512_loadu_ps(y + i);
+        __m512 total = _mm512_setzero_ps();
+        __m512 total_dx = _mm512_setzero_ps();
+        __m512 total_dy = _mm512_setzero_ps();
+        float frequency = 1.0;
+        float amplitude = 1.0;
+        float maxValue = 0;
+        for (int o = 0; o < octaves; o++) {
+            __m512 f = _mm512_set1_ps(frequency);
+            __m512 af = _mm512_set1_ps(amplitude * frequency);
+            __m512 nx, ny;
+            __m512 v = noise2_deriv_16(p, _mm512_mul_ps(vx, f), _mm512_mul_ps(vy, f), &nx, &ny);
+            total = _mm512_add_ps(total, _mm512_mul_ps(v, _mm512_set1_ps(amplitude)));
+            total_dx = _mm512_add_ps(total_dx, _mm512_mul_ps(nx, af));
+            total_dy = _mm512_add_ps(total_dy, _mm512_mul_ps(ny, af));
+            maxValue += amplitude;
+            amplitude *= persistence;
+            frequency *= lacunarity;
+        }
+        __m512 m = _mm512_set1_ps(maxValue);
+        _mm512_storeu_ps(out + i, _mm512_div_ps(total, m));
+        _mm512_storeu_ps(dx + i, _mm512_div_ps(total_dx, m));
+        _mm512_storeu_ps(dy + i, _mm512_div_ps(total_dy, m));
+    }
+    return i;
+}
+
+//---------------------------------------------------------------------
+// dispatch
+
+static int has_avx512() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+}
+
+static int has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+void cnoise2_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, int n,
+                       int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    if (has_avx512()) {
+        i = noise2_batch_avx512(ctx->perm, x, y, out, n, octaves, persistence, lacunarity);
+    }
+    else if (has_avx2()) {
+        i = noise2_batch_avx2(ctx->perm, x, y, out, n, octaves, persistence, lacunarity);
+    }
+    for (; i < n; i++) {
+        out[i] = cnoise2_ctx(ctx, x[i], y[i], octaves, persistence, lacunarity);
+    }
+}
+
+void cnoise3_batch_ctx(const rs_noise* ctx, const float* x, const float* y, const float* z, float* out, int n,
+                       int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    if (has_avx512()) {
+        i = noise3_batch_avx512(ctx->perm, x, y, z, out, n, octaves, persistence, lacunarity);
+    }
+    else if (has_avx2()) {
+        i = noise3_batch_avx2(ctx->perm, x, y, z, out, n, octaves, persistence, lacunarity);
+    }
+    for (; i < n; i++) {
+        out[i] = cnoise3_ctx(ctx, x[i], y[i], z[i], octaves, persistence, lacunarity);
+    }
+}
+
+void cnoise2_deriv_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, float* dx, float* dy,
+                             int n, int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    if (has_avx512()) {
+        i = noise2_deriv_batch_avx512(ctx->perm, x, y, out, dx, dy, n, octaves, persistence, lacunarity);
+    }
+    else if (has_avx2()) {
+        i = noise2_deriv_batch_avx2(ctx->perm, x, y, out, dx, dy, n, octaves, persistence, lacunarity);
+    }
+    for (; i < n; i++) {
+        out[i] = cnoise2_deriv_ctx(ctx, x[i], y[i], octaves, persistence, lacunarity, &dx[i], &dy[i]);
+    }
+}
+
+void cnoise2_filtered_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, int n,
+                                float footprint, int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    rs_octave_plan plan;
+    if (rs_make_octave_plan(&plan, footprint, octaves, persistence, lacunarity)) {
+        if (has_avx512()) {
+            i = noise2_filtered_batch_avx512(ctx->perm, x, y, out, n, &plan);
+        }
+        else if (has_avx2()) {
+            i = noise2_filtered_batch_avx2(ctx->perm, x, y, out, n, &plan);
+        }
+    }
+    for (; i < n; i++) {
+        out[i] = cnoise2_filtered_ctx(ctx, x[i], y[i], footprint, octaves, persistence, lacunarity);
+    }
+}
+
+void noise2_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, int n) {
+    // a single octave of cnoise2 is noise2 divided by an amplitude sum of 1
+    cnoise2_batch_ctx(ctx, x, y, out, n, 1, 1.0f, 1.0f);
+}
+
+void noise3_batch_ctx(const rs_noise* ctx, const float* x, const float* y, const float* z, float* out, int n) {
+    cnoise3_batch_ctx(ctx, x, y, z, out, n, 1, 1.0f, 1.0f);
+}
+
+void cnoise2_batch(const float* x, const float* y, float* out, int n, int octaves, float persistence, float lacunarity) {
+    cnoise2_batch_ctx(rs_default_noise(), x, y, out, n, octaves, persistence, lacunarity);
+}
+
+void cnoise3_batch(const float* x, const float* y, const float* z, float* out, int n, int octaves, float persistence, float lacunarity) {
+    cnoise3_batch_ctx(rs_default_noise(), x, y, z, out, n, octaves, persistence, lacunarity);
+}
+
+void noise2_batch(const float* x, const float* y, float* out, int n) {
+    noise2_batch_ctx(rs_default_noise(), x, y, out, n);
+}
+
+void noise3_batch(const float* x, const float* y, const float* z, float* out, int n) {
+    noise3_batch_ctx(rs_default_noise(), x, y, z, out, n);
+}
+
+void cnoise2_deriv_batch(const float* x, const float* y, float* out, float* dx, float* dy, int n,
+                         int octaves, float persistence, float lacunarity) {
+    cnoise2_deriv_batch_ctx(rs_default_noise(), x, y, out, dx, dy, n, octaves, persistence, lacunarity);
+}
+
+void cnoise2_filtered_batch(const float* x, const float* y, float* out, int n, float footprint,
+                            int octaves, float persistence, float lacunarity) {
+    cnoise2_filtered_batch_ctx(rs_default_noise(), x, y, out, n, footprint, octaves, persistence, lacunarity);
+}
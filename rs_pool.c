@@ -0,0 +1,174 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "rs_pool.h"
+
+struct rs_pool {
+    u32 num_threads;
+    pthread_t* threads;
+
+    pthread_mutex_t submit_lock;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    u64 generation;
+    u32 busy_workers;
+    int shutdown;
+
+    // the loop currently being run
+    rs_task_fn fn;
+    void* ctx;
+    u32 count;
+    u32 grain;
+    u32 next;
+};
+
+typedef struct {
+    rs_pool* pool;
+    u32 worker;
+} worker_args;
+
+// pool whose tasks the current thread is running and its worker index
+// there, NULL and -1 otherwise
+static __thread rs_pool* current_pool = NULL;
+static __thread int current_worker = -1;
+
+static void run_chunks(rs_pool* p, u32 worker) {
+    rs_pool* outer_pool = current_pool;
+    int outer = current_worker;
+    current_pool = p;
+    current_worker = (int)worker;
+    for (;;) {
+        u32 begin = __atomic_fetch_add(&p->next, p->grain, __ATOMIC_RELAXED);
+        if (begin >= p->count) break;
+        u32 end = (p->count - begin > p->grain) ? begin + p->grain : p->count;
+        p->fn(p->ctx, begin, end, worker);
+    }
+    current_pool = outer_pool;
+    current_worker = outer;
+}
+
+static void* worker_main(void* arg) {
+    worker_args* args = arg;
+    rs_pool* p = args->pool;
+    u32 worker = args->worker;
+    free(args);
+
+    u64 seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&p->lock);
+        while (!p->shutdown && p->generation == seen) {
+            pthread_cond_wait(&p->work_ready, &p->lock);
+        }
+        if (p->shutdown) {
+            pthread_mutex_unlock(&p->lock);
+            break;
+        }
+        seen = p->generation;
+        pthread_mutex_unlock(&p->lock);
+
+        run_chunks(p, worker);
+
+        pthread_mutex_lock(&p->lock);
+        if (--p->busy_workers == 0) {
+            pthread_cond_signal(&p->work_done);
+        }
+        pthread_mutex_unlock(&p->lock);
+    }
+    return NULL;
+}
+
+rs_pool* rs_make_pool(u32 num_threads) {
+    if (num_threads == 0) num_threads = 1;
+
+    rs_pool* p = calloc(1, sizeof(rs_pool));
+    p->num_threads = num_threads;
+    p->threads = calloc(num_threads, sizeof(pthread_t));
+    pthread_mutex_init(&p->submit_lock, NULL);
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->work_ready, NULL);
+    pthread_cond_init(&p->work_done, NULL);
+
+    for (u32 i = 1; i < num_threads; i++) {
+        worker_args* args = malloc(sizeof(worker_args));
+        args->pool = p;
+        args->worker = i;
+        pthread_create(&p->threads[i], NULL, worker_main, args);
+    }
+    return p;
+}
+
+void rs_free_pool(rs_pool* p) {
+    pthread_mutex_lock(&p->lock);
+    p->shutdown = 1;
+    pthread_cond_broadcast(&p->work_ready);
+    pthread_mutex_unlock(&p->lock);
+
+    for (u32 i = 1; i < p->num_threads; i++) {
+        pthread_join(p->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&p->work_done);
+    pthread_cond_destroy(&p->work_ready);
+    pthread_mutex_destroy(&p->lock);
+    pthread_mutex_destroy(&p->submit_lock);
+    free(p->threads);
+    free(p);
+}
+
+u32 rs_pool_size(rs_pool* p) {
+    return p->num_threads;
+}
+
+static rs_pool* default_pool = NULL;
+static pthread_once_t default_pool_once = PTHREAD_ONCE_INIT;
+
+static void make_default_pool() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    default_pool = rs_make_pool(cores > 0 ? (u32)cores : 1);
+}
+
+rs_pool* rs_default_pool() {
+    pthread_once(&default_pool_once, make_default_pool);
+    return default_pool;
+}
+
+void rs_pool_parallel_for(rs_pool* p, u32 count, u32 grain, rs_task_fn fn, void* ctx) {
+    if (count == 0) return;
+    if (grain == 0) grain = 1;
+
+    // nested loops and loops that fit in one chunk stay on this thread
+    if (p->num_threads == 1 || count <= grain || current_worker >= 0) {
+        // the outer index is only valid for scratch sized by this pool
+        u32 worker = (current_pool == p && current_worker >= 0) ? (u32)current_worker : 0;
+        for (u32 begin = 0; begin < count; begin += grain) {
+            fn(ctx, begin, (count - begin > grain) ? begin + grain : count, worker);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&p->submit_lock);
+
+    pthread_mutex_lock(&p->lock);
+    p->fn = fn;
+    p->ctx = ctx;
+    p->count = count;
+    p->grain = grain;
+    p->next = 0;
+    p->busy_workers = p->num_threads - 1;
+    p->generation++;
+    pthread_cond_broadcast(&p->work_ready);
+    pthread_mutex_unlock(&p->lock);
+
+    run_chunks(p, 0);
+
+    pthread_mutex_lock(&p->lock);
+    while (p->busy_workers > 0) {
+        pthread_cond_wait(&p->work_done, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    pthread_mutex_unlock(&p->submit_lock);
+}
@@ -0,0 +1,30 @@
+#ifndef RS_POOL_H
+#define RS_POOL_H
+
+#include "rs.h"
+
+//
+// fixed-size thread pool for data parallel loops. the thread calling
+// rs_pool_parallel_for works on the loop too and is always worker 0,
+// background threads are workers 1..rs_pool_size()-1, so per-worker
+// scratch can be indexed by the worker argument. rs_pool itself is
+// declared in rs.h.
+//
+
+// called with a half-open range [begin, end) of the loop
+typedef void (*rs_task_fn)(void* ctx, u32 begin, u32 end, u32 worker);
+
+rs_pool* rs_make_pool(u32 num_threads);
+void rs_free_pool(rs_pool* p);
+u32 rs_pool_size(rs_pool* p);
+
+// shared pool sized to the number of online cores, created on first use
+rs_pool* rs_default_pool();
+
+// runs fn over [0, count) in chunks of grain items and returns when every
+// chunk is done. chunks always start at a multiple of grain. calls made
+// from inside a pool task run serially on the calling thread, as the
+// same worker when p is the pool of that task and as worker 0 otherwise.
+void rs_pool_parallel_for(rs_pool* p, u32 count, u32 grain, rs_task_fn fn, void* ctx);
+
+#endif
@@ -0,0 +1,284 @@
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include "rs_pyramid.h"
+#include "rs_pool.h"
+
+#define PYRAMID_ROWS (16)
+
+typedef struct {
+    rs_pyramid* p;
+    u32 level;
+    u32 x0, x1;
+    u32 y0;
+} level_job;
+
+// cells of level l from the up to four cells under them in level l-1
+static void level_rows(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    level_job* job = ctx;
+    rs_grid* src_min = job->p->min[job->level - 1];
+    rs_grid* src_max = job->p->max[job->level - 1];
+    rs_grid* dst_min = job->p->min[job->level];
+    rs_grid* dst_max = job->p->max[job->level];
+    u32 sw = src_min->width;
+    u32 sh = src_min->height;
+
+    for (u32 y = job->y0 + begin; y < job->y0 + end; y++) {
+        u32 sy0 = 2 * y;
+        u32 sy1 = 2 * y + 1 < sh ? 2 * y + 1 : sy0;
+        for (u32 x = job->x0; x < job->x1; x++) {
+            u32 sx0 = 2 * x;
+            u32 sx1 = 2 * x + 1 < sw ? 2 * x + 1 : sx0;
+            float lo = fminf(fminf(src_min->data[sx0 + sy0 * sw], src_min->data[sx1 + sy0 * sw]),
+                             fminf(src_min->data[sx0 + sy1 * sw], src_min->data[sx1 + sy1 * sw]));
+            float hi = fmaxf(fmaxf(src_max->data[sx0 + sy0 * sw], src_max->data[sx1 + sy0 * sw]),
+                             fmaxf(src_max->data[sx0 + sy1 * sw], src_max->data[sx1 + sy1 * sw]));
+            dst_min->data[x + y * dst_min->width] = lo;
+            dst_max->data[x + y * dst_max->width] = hi;
+        }
+    }
+}
+
+rs_pyramid* rs_make_pyramid(rs_grid* g) {
+    rs_pyramid* p = malloc(sizeof(rs_pyramid));
+    p->grid = g;
+
+    p->num_levels = 1;
+    for (u32 w = g->width, h = g->height; w > 1 || h > 1; w = (w + 1) / 2, h = (h + 1) / 2) {
+        p->num_levels++;
+    }
+
+    p->min = malloc(p->num_levels * sizeof(rs_grid*));
+    p->max = malloc(p->num_levels * sizeof(rs_grid*));
+    p->min[0] = p->max[0] = g;
+    for (u32 l = 1; l < p->num_levels; l++) {
+        u32 w = (p->min[l-1]->width + 1) / 2;
+        u32 h = (p->min[l-1]->height + 1) / 2;
+        p->min[l] = rs_make_grid(w, h);
+        p->max[l] = rs_make_grid(w, h);
+    }
+
+    rs_pyramid_update(p, 0, 0, g->width, g->height);
+    return p;
+}
+
+void rs_free_pyramid(rs_pyramid* p) {
+    for (u32 l = 1; l < p->num_levels; l++) {
+        rs_free_grid(p->min[l]);
+        rs_free_grid(p->max[l]);
+    }
+    free(p->min);
+    free(p->max);
+    free(p);
+}
+
+void rs_pyramid_update(rs_pyramid* p, u32 x0, u32 y0, u32 w, u32 h) {
+    if (w == 0 || h == 0) return;
+    u32 x1 = x0 + w;
+    u32 y1 = y0 + h;
+    for (u32 l = 1; l < p->num_levels; l++) {
+        // the cells over the changed cells of the level below
+        x0 /= 2;
+        y0 /= 2;
+        x1 = (x1 + 1) / 2;
+        y1 = (y1 + 1) / 2;
+        if (x1 > p->min[l]->width) x1 = p->min[l]->width;
+        if (y1 > p->min[l]->height) y1 = p->min[l]->height;
+        if (x0 >= x1 || y0 >= y1) return;
+
+        level_job job = { p, l, x0, x1, y0 };
+        rs_pool_parallel_for(rs_default_pool(), y1 - y0, PYRAMID_ROWS, level_rows, &job);
+    }
+}
+
+//
+// range queries
+//
+
+typedef struct {
+    u32 x0, y0, x1, y1;       // half-open rect in grid cells
+} rect;
+
+static void range_visit(rs_pyramid* p, rect* r, u32 l, u32 bx, u32 by, rs_range* out) {
+    u32 cx0 = bx << l;
+    u32 cy0 = by << l;
+    u32 cx1 = cx0 + (1u << l);
+    u32 cy1 = cy0 + (1u << l);
+    if (cx0 >= r->x1 || cy0 >= r->y1 || cx1 <= r->x0 || cy1 <= r->y0) return;
+
+    u32 i = bx + by * p->min[l]->width;
+    if (p->min[l]->data[i] >= out->min && p->max[l]->data[i] <= out->max) return;
+
+    if (l == 0 || (cx0 >= r->x0 && cy0 >= r->y0 && cx1 <= r->x1 && cy1 <= r->y1)) {
+        if (p->min[l]->data[i] < out->min) out->min = p->min[l]->data[i];
+        if (p->max[l]->data[i] > out->max) out->max = p->max[l]->data[i];
+        return;
+    }
+
+    u32 w = p->min[l-1]->width;
+    u32 h = p->min[l-1]->height;
+    for (u32 cy = 2 * by; cy < 2 * by + 2 && cy < h; cy++) {
+        for (u32 cx = 2 * bx; cx < 2 * bx + 2 && cx < w; cx++) {
+            range_visit(p, r, l - 1, cx, cy, out);
+        }
+    }
+}
+
+rs_range rs_pyramid_range(rs_pyramid* p, u32 x0, u32 y0, u32 w, u32 h) {
+    rs_range out = { FLT_MAX, -FLT_MAX };
+    rect r = { x0, y0, x0 + w, y0 + h };
+    if (r.x1 > p->grid->width) r.x1 = p->grid->width;
+    if (r.y1 > p->grid->height) r.y1 = p->grid->height;
+    if (r.x0 >= r.x1 || r.y0 >= r.y1) return out;
+    range_visit(p, &r, p->num_levels - 1, 0, 0, &out);
+    return out;
+}
+
+typedef struct {
+    float best;
+    u32 x, y;
+} highest_state;
+
+static void highest_visit(rs_pyramid* p, rect* r, u32 l, u32 bx, u32 by, highest_state* s) {
+    u32 cx0 = bx << l;
+    u32 cy0 = by << l;
+    u32 cx1 = cx0 + (1u << l);
+    u32 cy1 = cy0 + (1u << l);
+    if (cx0 >= r->x1 || cy0 >= r->y1 || cx1 <= r->x0 || cy1 <= r->y0) return;
+
+    // nothing under this block can beat the best so far
+    float hi = p->max[l]->data[bx + by * p->max[l]->width];
+    if (hi <= s->best) return;
+
+    if (l == 0) {
+        s->best = hi;
+        s->x = bx;
+        s->y = by;
+        return;
+    }
+
+    // highest children first, so the bound tightens early
+    u32 w = p->max[l-1]->width;
+    u32 h = p->max[l-1]->height;
+    u32 cx[4], cy[4];
+    float cmax[4];
+    int n = 0;
+    for (u32 y = 2 * by; y < 2 * by + 2 && y < h; y++) {
+        for (u32 x = 2 * bx; x < 2 * bx + 2 && x < w; x++) {
+            float m = p->max[l-1]->data[x + y * w];
+            int k = n++;
+            while (k > 0 && cmax[k-1] < m) {
+                cmax[k] = cmax[k-1];
+                cx[k] = cx[k-1];
+                cy[k] = cy[k-1];
+                k--;
+            }
+            cmax[k] = m;
+            cx[k] = x;
+            cy[k] = y;
+        }
+    }
+    for (int k = 0; k < n; k++) {
+        highest_visit(p, r, l - 1, cx[k], cy[k], s);
+    }
+}
+
+float rs_pyramid_highest(rs_pyramid* p, u32 x0, u32 y0, u32 w, u32 h, u32* hx, u32* hy) {
+    highest_state s = { -FLT_MAX, x0, y0 };
+    rect r = { x0, y0, x0 + w, y0 + h };
+    if (r.x1 > p->grid->width) r.x1 = p->grid->width;
+    if (r.y1 > p->grid->height) r.y1 = p->grid->height;
+    if (r.x0 < r.x1 && r.y0 < r.y1) {
+        highest_visit(p, &r, p->num_levels - 1, 0, 0, &s);
+    }
+    if (hx != NULL) *hx = s.x;
+    if (hy != NULL) *hy = s.y;
+    return s.best;
+}
+
+//
+// ray casting. the ray walks block by block at the coarsest level whose
+// block it passes over entirely, dropping a level when the block's max
+// reaches the ray and climbing one after every skipped block.
+//
+
+// parameter where the ray leaves [lo, lo + size) along one axis
+static float axis_exit(float o, float d, float lo, float size) {
+    if (d > 0) return (lo + size - o) / d;
+    if (d < 0) return (lo - o) / d;
+    return FLT_MAX;
+}
+
+// narrows [t0, t1] to where the ray is inside [0, size) along one axis,
+// returns 0 when it never is
+static int clip_axis(float o, float d, float size, float* t0, float* t1) {
+    if (d == 0) return o >= 0 && o < size;
+    float a = (0 - o) / d;
+    float b = (size - o) / d;
+    if (a > b) {
+        float t = a;
+        a = b;
+        b = t;
+    }
+    if (a > *t0) *t0 = a;
+    if (b < *t1) *t1 = b;
+    return *t0 <= *t1;
+}
+
+int rs_pyramid_raycast(rs_pyramid* p, Vector3 origin, Vector3 dir, float max_t, float* t_hit) {
+    float t = 0;
+    float t_end = max_t;
+    if (!clip_axis(origin.x, dir.x, (float)p->grid->width, &t, &t_end)) return 0;
+    if (!clip_axis(origin.y, dir.y, (float)p->grid->height, &t, &t_end)) return 0;
+
+    // nudges past block boundaries, relative to the ray length
+    float len = sqrtf(dir.x * dir.x + dir.y * dir.y);
+    float eps = len > 0 ? 1e-4f / len : 0;
+
+    u32 top = p->num_levels - 1;
+    u32 l = top;
+    while (t <= t_end) {
+        float px = origin.x + t * dir.x;
+        float py = origin.y + t * dir.y;
+        if (px < 0 || py < 0 || px >= p->grid->width || py >= p->grid->height) return 0;
+
+        u32 bx = (u32)px >> l;
+        u32 by = (u32)py >> l;
+        float size = (float)(1u << l);
+        float t_exit = fminf(axis_exit(px, dir.x, bx * size, size), axis_exit(py, dir.y, by * size, size));
+        float t_next = fminf(t + t_exit, t_end);
+
+        float z0 = origin.z + t * dir.z;
+        float z1 = origin.z + t_next * dir.z;
+        float ray_min = fminf(z0, z1);
+        float block_max = p->max[l]->data[bx + by * p->max[l]->width];
+
+        if (ray_min > block_max) {
+            // clear over the whole block
+            t = t_next + eps;
+            if (l < top) l++;
+            continue;
+        }
+        if (l > 0) {
+            l--;
+            continue;
+        }
+
+        // the column of this cell reaches the ray between t and t_next
+        if (z0 <= block_max) {
+            *t_hit = t;
+        }
+        else {
+            *t_hit = t + (z0 - block_max) / (z0 - z1) * (t_next - t);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int rs_pyramid_visible(rs_pyramid* p, Vector3 a, Vector3 b) {
+    Vector3 dir = { b.x - a.x, b.y - a.y, b.z - a.z };
+    float t;
+    return !rs_pyramid_raycast(p, a, dir, 1.0f, &t);
+}
@@ -0,0 +1,40 @@
+#ifndef RS_PYRAMID_H
+#define RS_PYRAMID_H
+
+#include "rs.h"
+#include "rs_stats.h"
+
+//
+// min/max pyramid over a height grid. level 0 is the grid itself, a cell
+// of level l holds the min and max of the 2^l x 2^l block of grid cells
+// under it, up to a single cell over everything. range queries and ray
+// casts walk the levels so whole blocks are accepted or skipped at once.
+//
+// cell (x, y) of the grid is the flat topped column over [x, x+1) x
+// [y, y+1) with its value as height.
+//
+typedef struct {
+    rs_grid* grid;            // not owned
+    u32 num_levels;           // including the grid
+    rs_grid** min;            // [0] and [0] of max are the grid
+    rs_grid** max;
+} rs_pyramid;
+
+rs_pyramid* rs_make_pyramid(rs_grid* g);
+void rs_free_pyramid(rs_pyramid* p);
+// refreshes the levels above a rect of the grid after its cells changed
+void rs_pyramid_update(rs_pyramid* p, u32 x0, u32 y0, u32 w, u32 h);
+
+// min and max over a rect of the grid
+rs_range rs_pyramid_range(rs_pyramid* p, u32 x0, u32 y0, u32 w, u32 h);
+// highest cell in a rect, returns its height and writes its position
+float rs_pyramid_highest(rs_pyramid* p, u32 x0, u32 y0, u32 w, u32 h, u32* hx, u32* hy);
+
+// first point where origin + t * dir, 0 <= t <= max_t, enters a column.
+// returns 1 and writes t on a hit, 0 when the ray leaves the grid or
+// reaches max_t in the clear
+int rs_pyramid_raycast(rs_pyramid* p, Vector3 origin, Vector3 dir, float max_t, float* t_hit);
+// whether the segment from a to b clears the terrain
+int rs_pyramid_visible(rs_pyramid* p, Vector3 a, Vector3 b);
+
+#endif
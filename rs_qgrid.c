@@ -0,0 +1,423 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <immintrin.h>
+#include "rs_qgrid.h"
+#include "rs_pool.h"
+
+#define AVX2 __attribute__((target("avx2")))
+#define F16C __attribute__((target("avx2,f16c")))
+
+// cells per task, and cells converted at a time through a float buffer
+#define QGRID_GRAIN (1 << 16)
+#define QGRID_BLOCK (1024)
+
+static int has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static int has_f16c() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+}
+
+static float code_max(rs_qgrid_type type) {
+    switch (type) {
+        case RS_QGRID_U16: return 65535.0f;
+        case RS_QGRID_U8:  return 255.0f;
+        default:           return 0;
+    }
+}
+
+//
+// scalar conversions, rounding the same way as the vector kernels
+//
+
+// round to nearest even like vcvtps2ph, NaNs stay quiet NaNs
+static u16 float_to_half(float f) {
+    u32 x;
+    memcpy(&x, &f, sizeof(x));
+    u32 sign = (x >> 16) & 0x8000;
+    u32 a = x & 0x7fffffff;
+
+    if (a >= 0x7f800000) {
+        if (a == 0x7f800000) return sign | 0x7c00;
+        return sign | 0x7e00 | ((a >> 13) & 0x3ff);
+    }
+    // 65520 and up round to infinity
+    if (a >= 0x477ff000) return sign | 0x7c00;
+    if (a < 0x38800000) {
+        // subnormal, adding 0.5 leaves the rounded multiple of 2^-24 in
+        // the low mantissa bits
+        float t;
+        memcpy(&t, &a, sizeof(t));
+        t += 0.5f;
+        u32 r;
+        memcpy(&r, &t, sizeof(r));
+        return sign | (u16)(r - 0x3f000000);
+    }
+    // rebias the exponent and round the 13 dropped bits
+    a += 0xc8000fff + ((a >> 13) & 1);
+    return sign | (u16)(a >> 13);
+}
+
+static float half_to_float(u16 h) {
+    u32 sign = (u32)(h & 0x8000) << 16;
+    u32 e = (h >> 10) & 0x1f;
+    u32 m = h & 0x3ff;
+    u32 x;
+    if (e == 0) {
+        float f = m * (1.0f / 16777216.0f);
+        memcpy(&x, &f, sizeof(x));
+        x |= sign;
+    } else if (e == 31) {
+        x = sign | 0x7f800000 | (m << 13) | (m ? 0x400000 : 0);
+    } else {
+        x = sign | ((e + 112) << 23) | (m << 13);
+    }
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static u32 quantize(float v, float offset, float inv_scale, float max) {
+    float t = (v - offset) * inv_scale;
+    if (!(t > 0)) t = 0;
+    if (t > max) t = max;
+    return (u32)lrintf(t);
+}
+
+//
+// span kernels
+//
+
+F16C static u32 decode_f16_avx2(const u16* src, u32 n, float* out) {
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+    }
+    return i;
+}
+
+F16C static u32 encode_f16_avx2(u16* dst, u32 n, const float* in) {
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i*)(dst + i), h);
+    }
+    return i;
+}
+
+AVX2 static u32 decode_u16_avx2(const u16* src, u32 n, float* out, float scale, float offset) {
+    __m256 s = _mm256_set1_ps(scale);
+    __m256 o = _mm256_set1_ps(offset);
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i c = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + i)));
+        __m256 x = _mm256_cvtepi32_ps(c);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(x, s), o));
+    }
+    return i;
+}
+
+AVX2 static u32 decode_u8_avx2(const u8* src, u32 n, float* out, float scale, float offset) {
+    __m256 s = _mm256_set1_ps(scale);
+    __m256 o = _mm256_set1_ps(offset);
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i c = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i)));
+        __m256 x = _mm256_cvtepi32_ps(c);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(x, s), o));
+    }
+    return i;
+}
+
+// codes of 8 cells as 32-bit lanes, clamped like quantize()
+AVX2 static inline __m256i quantize8(const float* in, __m256 o, __m256 inv, __m256 max) {
+    __m256 t = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(in), o), inv);
+    // max returns its second operand for NaN, sending NaN to 0
+    t = _mm256_max_ps(t, _mm256_setzero_ps());
+    t = _mm256_min_ps(t, max);
+    return _mm256_cvtps_epi32(t);
+}
+
+AVX2 static u32 encode_u16_avx2(u16* dst, u32 n, const float* in, float offset, float inv_scale) {
+    __m256 o = _mm256_set1_ps(offset);
+    __m256 inv = _mm256_set1_ps(inv_scale);
+    __m256 max = _mm256_set1_ps(65535.0f);
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i c = quantize8(in + i, o, inv, max);
+        c = _mm256_permute4x64_epi64(_mm256_packus_epi32(c, c), 0x08);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(c));
+    }
+    return i;
+}
+
+AVX2 static u32 encode_u8_avx2(u8* dst, u32 n, const float* in, float offset, float inv_scale) {
+    __m256 o = _mm256_set1_ps(offset);
+    __m256 inv = _mm256_set1_ps(inv_scale);
+    __m256 max = _mm256_set1_ps(255.0f);
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i c = quantize8(in + i, o, inv, max);
+        c = _mm256_packus_epi32(c, c);
+        c = _mm256_packus_epi16(c, c);
+        c = _mm256_permutevar8x32_epi32(c, _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+        _mm_storel_epi64((__m128i*)(dst + i), _mm256_castsi256_si128(c));
+    }
+    return i;
+}
+
+void rs_qgrid_decode(rs_qgrid* q, u32 begin, u32 n, float* out) {
+    u32 i = 0;
+    switch (q->type) {
+        case RS_QGRID_F32:
+            memcpy(out, (float*)q->data + begin, n * sizeof(float));
+            break;
+        case RS_QGRID_F16: {
+            const u16* src = (const u16*)q->data + begin;
+            if (has_f16c()) i = decode_f16_avx2(src, n, out);
+            for (; i < n; i++) out[i] = half_to_float(src[i]);
+            break;
+        }
+        case RS_QGRID_U16: {
+            const u16* src = (const u16*)q->data + begin;
+            if (has_avx2()) i = decode_u16_avx2(src, n, out, q->scale, q->offset);
+            for (; i < n; i++) out[i] = src[i] * q->scale + q->offset;
+            break;
+        }
+        case RS_QGRID_U8: {
+            const u8* src = (const u8*)q->data + begin;
+            if (has_avx2()) i = decode_u8_avx2(src, n, out, q->scale, q->offset);
+            for (; i < n; i++) out[i] = src[i] * q->scale + q->offset;
+            break;
+        }
+    }
+}
+
+void rs_qgrid_encode(rs_qgrid* q, u32 begin, u32 n, const float* in) {
+    u32 i = 0;
+    switch (q->type) {
+        case RS_QGRID_F32:
+            memcpy((float*)q->data + begin, in, n * sizeof(float));
+            break;
+        case RS_QGRID_F16: {
+            u16* dst = (u16*)q->data + begin;
+            if (has_f16c()) i = encode_f16_avx2(dst, n, in);
+            for (; i < n; i++) dst[i] = float_to_half(in[i]);
+            break;
+        }
+        case RS_QGRID_U16: {
+            u16* dst = (u16*)q->data + begin;
+            if (has_avx2()) i = encode_u16_avx2(dst, n, in, q->offset, q->inv_scale);
+            for (; i < n; i++) dst[i] = (u16)quantize(in[i], q->offset, q->inv_scale, 65535.0f);
+            break;
+        }
+        case RS_QGRID_U8: {
+            u8* dst = (u8*)q->data + begin;
+            if (has_avx2()) i = encode_u8_avx2(dst, n, in, q->offset, q->inv_scale);
+            for (; i < n; i++) dst[i] = (u8)quantize(in[i], q->offset, q->inv_scale, 255.0f);
+            break;
+        }
+    }
+}
+
+//
+// rs_qgrid functions
+//
+
+size_t rs_qgrid_cell_bytes(rs_qgrid_type type) {
+    switch (type) {
+        case RS_QGRID_F32: return sizeof(float);
+        case RS_QGRID_F16: return sizeof(u16);
+        case RS_QGRID_U16: return sizeof(u16);
+        case RS_QGRID_U8:  return sizeof(u8);
+    }
+    return sizeof(float);
+}
+
+size_t rs_qgrid_bytes(rs_qgrid* q) {
+    return (size_t)q->size * rs_qgrid_cell_bytes(q->type);
+}
+
+rs_qgrid* rs_make_qgrid(u32 width, u32 height, rs_qgrid_type type, float lo, float hi) {
+    rs_qgrid* q = malloc(sizeof(rs_qgrid));
+    q->width = width;
+    q->height = height;
+    q->size = width * height;
+    q->type = type;
+    q->scale = 0;
+    q->offset = 0;
+    q->inv_scale = 0;
+
+    float max = code_max(type);
+    if (max > 0) {
+        if (hi < lo) {
+            float t = hi;
+            hi = lo;
+            lo = t;
+        }
+        // a flat range keeps every cell at lo
+        q->offset = lo;
+        q->scale = (hi - lo) / max;
+        q->inv_scale = hi > lo ? max / (hi - lo) : 0;
+    }
+
+    // every type reads back 0 bits as the value 0 or lo
+    q->data = calloc(q->size > 0 ? q->size : 1, rs_qgrid_cell_bytes(type));
+    return q;
+}
+
+void rs_free_qgrid(rs_qgrid* q) {
+    if (q == NULL) return;
+    free(q->data);
+    free(q);
+}
+
+float rs_qgrid_get(rs_qgrid* q, u32 x, u32 y) {
+    if (x >= q->width) return 0;
+    if (y >= q->height) return 0;
+    u32 i = x + y * q->width;
+    switch (q->type) {
+        case RS_QGRID_F32: return ((float*)q->data)[i];
+        case RS_QGRID_F16: return half_to_float(((u16*)q->data)[i]);
+        case RS_QGRID_U16: return ((u16*)q->data)[i] * q->scale + q->offset;
+        case RS_QGRID_U8:  return ((u8*)q->data)[i] * q->scale + q->offset;
+    }
+    return 0;
+}
+
+void rs_qgrid_set(rs_qgrid* q, u32 x, u32 y, float value) {
+    if (x >= q->width) return;
+    if (y >= q->height) return;
+    u32 i = x + y * q->width;
+    switch (q->type) {
+        case RS_QGRID_F32:
+            ((float*)q->data)[i] = value;
+            break;
+        case RS_QGRID_F16:
+            ((u16*)q->data)[i] = float_to_half(value);
+            break;
+        case RS_QGRID_U16:
+            ((u16*)q->data)[i] = (u16)quantize(value, q->offset, q->inv_scale, 65535.0f);
+            break;
+        case RS_QGRID_U8:
+            ((u8*)q->data)[i] = (u8)quantize(value, q->offset, q->inv_scale, 255.0f);
+            break;
+    }
+}
+
+//
+// whole grid operations
+//
+
+typedef struct {
+    rs_qgrid* dst;
+    rs_qgrid* src;
+    float* data;
+    float value;
+    rs_range* ranges;
+} qgrid_job;
+
+static void store_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    qgrid_job* job = ctx;
+    rs_qgrid_encode(job->dst, begin, end - begin, job->data + begin);
+}
+
+void rs_qgrid_store(rs_qgrid* q, rs_grid* g) {
+    if (q->width != g->width || q->height != g->height) return;
+    qgrid_job job = { .dst = q, .data = g->data };
+    rs_pool_parallel_for(rs_default_pool(), q->size, QGRID_GRAIN, store_chunks, &job);
+}
+
+static void load_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    qgrid_job* job = ctx;
+    rs_qgrid_decode(job->src, begin, end - begin, job->data + begin);
+}
+
+void rs_qgrid_load(rs_qgrid* q, rs_grid* g) {
+    if (q->width != g->width || q->height != g->height) return;
+    qgrid_job job = { .src = q, .data = g->data };
+    rs_pool_parallel_for(rs_default_pool(), q->size, QGRID_GRAIN, load_chunks, &job);
+}
+
+rs_qgrid* rs_quantize_grid(rs_grid* g, rs_qgrid_type type, float lo, float hi) {
+    rs_qgrid* q = rs_make_qgrid(g->width, g->height, type, lo, hi);
+    rs_qgrid_store(q, g);
+    return q;
+}
+
+rs_grid* rs_dequantize_grid(rs_qgrid* q) {
+    rs_grid* g = rs_make_grid(q->width, q->height);
+    rs_qgrid_load(q, g);
+    return g;
+}
+
+static void convert_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    qgrid_job* job = ctx;
+    float block[QGRID_BLOCK];
+    for (u32 i = begin; i < end; i += QGRID_BLOCK) {
+        u32 n = end - i < QGRID_BLOCK ? end - i : QGRID_BLOCK;
+        rs_qgrid_decode(job->src, i, n, block);
+        rs_qgrid_encode(job->dst, i, n, block);
+    }
+}
+
+void rs_qgrid_convert(rs_qgrid* dst, rs_qgrid* src) {
+    if (dst->width != src->width || dst->height != src->height) return;
+    qgrid_job job = { .dst = dst, .src = src };
+    rs_pool_parallel_for(rs_default_pool(), dst->size, QGRID_GRAIN, convert_chunks, &job);
+}
+
+static void fill_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    qgrid_job* job = ctx;
+    float block[QGRID_BLOCK];
+    for (u32 k = 0; k < QGRID_BLOCK; k++) {
+        block[k] = job->value;
+    }
+    for (u32 i = begin; i < end; i += QGRID_BLOCK) {
+        u32 n = end - i < QGRID_BLOCK ? end - i : QGRID_BLOCK;
+        rs_qgrid_encode(job->dst, i, n, block);
+    }
+}
+
+void rs_qgrid_fill(rs_qgrid* q, float value) {
+    qgrid_job job = { .dst = q, .value = value };
+    rs_pool_parallel_for(rs_default_pool(), q->size, QGRID_GRAIN, fill_chunks, &job);
+}
+
+static void minmax_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    qgrid_job* job = ctx;
+    float block[QGRID_BLOCK];
+    rs_range r = { FLT_MAX, -FLT_MAX };
+    for (u32 i = begin; i < end; i += QGRID_BLOCK) {
+        u32 n = end - i < QGRID_BLOCK ? end - i : QGRID_BLOCK;
+        rs_qgrid_decode(job->src, i, n, block);
+        r = rs_range_merge(r, block, n);
+    }
+    job->ranges[begin / QGRID_GRAIN] = r;
+}
+
+rs_range rs_qgrid_minmax(rs_qgrid* q) {
+    u32 n = (q->size + QGRID_GRAIN - 1) / QGRID_GRAIN;
+    qgrid_job job = { .src = q };
+    job.ranges = malloc((n > 0 ? n : 1) * sizeof(rs_range));
+    rs_pool_parallel_for(rs_default_pool(), q->size, QGRID_GRAIN, minmax_chunks, &job);
+
+    rs_range r = { FLT_MAX, -FLT_MAX };
+    for (u32 i = 0; i < n; i++) {
+        if (job.ranges[i].min < r.min) r.min = job.ranges[i].min;
+        if (job.ranges[i].max > r.max) r.max = job.ranges[i].max;
+    }
+    free(job.ranges);
+    return r;
+}
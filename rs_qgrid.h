@@ -0,0 +1,61 @@
+#ifndef RS_QGRID_H
+#define RS_QGRID_H
+
+#include <stddef.h>
+#include "rs.h"
+#include "rs_stats.h"
+
+//
+// typed grid storage for layers that don't need 32-bit floats. integer
+// cells hold code = round((v - lo) / step) clamped to the code range and
+// read back as code * step + lo, so a u16 map over 100..200 keeps steps of
+// 0.0015 in half the memory of an rs_grid, and a u8 one in a quarter.
+// half floats keep 11 significant bits over any range and are converted
+// with F16C when the cpu has it. whole grid conversions are split over
+// rs_default_pool().
+//
+
+typedef enum {
+    RS_QGRID_F32,
+    RS_QGRID_F16,
+    RS_QGRID_U16,
+    RS_QGRID_U8,
+} rs_qgrid_type;
+
+typedef struct {
+    u32 width;
+    u32 height;
+    u32 size;
+    rs_qgrid_type type;
+    float scale;              // step between integer codes, 0 for float types
+    float offset;             // value of code 0
+    float inv_scale;
+    void* data;
+} rs_qgrid;
+
+// lo and hi give the value range of integer types, cells outside it clamp.
+// float types ignore them
+rs_qgrid* rs_make_qgrid(u32 width, u32 height, rs_qgrid_type type, float lo, float hi);
+void rs_free_qgrid(rs_qgrid* q);
+size_t rs_qgrid_cell_bytes(rs_qgrid_type type);
+size_t rs_qgrid_bytes(rs_qgrid* q);
+
+float rs_qgrid_get(rs_qgrid* q, u32 x, u32 y);
+void rs_qgrid_set(rs_qgrid* q, u32 x, u32 y, float value);
+
+// n cells starting at cell index begin, to and from floats
+void rs_qgrid_decode(rs_qgrid* q, u32 begin, u32 n, float* out);
+void rs_qgrid_encode(rs_qgrid* q, u32 begin, u32 n, const float* in);
+
+// quantized copy of g over [lo, hi]
+rs_qgrid* rs_quantize_grid(rs_grid* g, rs_qgrid_type type, float lo, float hi);
+rs_grid* rs_dequantize_grid(rs_qgrid* q);
+// whole grid copies between grids of the same size
+void rs_qgrid_store(rs_qgrid* q, rs_grid* g);
+void rs_qgrid_load(rs_qgrid* q, rs_grid* g);
+void rs_qgrid_convert(rs_qgrid* dst, rs_qgrid* src);
+
+void rs_qgrid_fill(rs_qgrid* q, float value);
+rs_range rs_qgrid_minmax(rs_qgrid* q);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef RS_RAND_H
+#define RS_RAND_H
+
+#include <stdint.h>
+
+//
+// counter-based random numbers. every value is a pure function of a key
+// and a counter, so a stream can be split across threads by handing each
+// chunk of work its own key (or counter range) without any shared state.
+// it needs only stdint.h, the noise library shuffles its tables with it.
+//
+
+#define RS_RAND_GOLDEN 0x9E3779B97F4A7C15ull
+
+typedef struct {
+    uint64_t key;
+    uint64_t counter;
+} rs_rng;
+
+// splitmix64 finalizer
+static inline uint64_t rs_hash64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+static inline uint64_t rs_rand_at(uint64_t key, uint64_t counter) {
+    return rs_hash64(key + counter * RS_RAND_GOLDEN);
+}
+
+// independent stream number `stream` of the sequence for `seed`
+static inline rs_rng rs_make_rng(uint64_t seed, uint64_t stream) {
+    rs_rng r = { rs_hash64(seed ^ rs_hash64(stream + RS_RAND_GOLDEN)), 0 };
+    return r;
+}
+
+static inline uint32_t rs_rng_u32(rs_rng* r) {
+    return (uint32_t)(rs_rand_at(r->key, r->counter++) >> 32);
+}
+
+// uniform in [0, 1)
+static inline float rs_rng_float(rs_rng* r) {
+    return (float)(rs_rng_u32(r) >> 8) * (1.0f / 16777216.0f);
+}
+
+// uniform in [0, n)
+static inline uint32_t rs_rng_below(rs_rng* r, uint32_t n) {
+    return (uint32_t)(((uint64_t)rs_rng_u32(r) * n) >> 32);
+}
+
+// uniform in [lo, hi)
+static inline float rs_rng_range(rs_rng* r, float lo, float hi) {
+    return lo + rs_rng_float(r) * (hi - lo);
+}
+
+#endif
@@ -0,0 +1,257 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "rs_scheduler.h"
+#include "rs_pool.h"
+
+enum { JOB_NEW, JOB_QUEUED, JOB_RUNNING };
+
+typedef struct rs_chunk_job {
+    int cx, cy;
+    float priority;             // squared distance, smallest runs first
+    u32 stamp;                  // last update that wanted the chunk
+    int state;                  // guarded by the scheduler lock
+    int cancelled;              // atomic
+    rs_grid* map;
+    struct rs_chunk_job* next;  // completion stack
+} rs_chunk_job;
+
+struct rs_chunk_scheduler {
+    rs_chunks* chunks;
+    u32 num_threads;
+    pthread_t* threads;
+    // chunks are generated serially on each worker thread, they run in
+    // parallel with each other instead of with the default pool
+    rs_pool* serial;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    int shutdown;
+    rs_chunk_job** heap;
+    u32 heap_count;
+    u32 heap_capacity;
+
+    // every queued, running or finished but not yet collected job. only
+    // touched by the thread calling update
+    rs_chunk_job** live;
+    u32 live_count;
+    u32 live_capacity;
+
+    // lock-free stack of finished jobs, pushed by the workers and taken
+    // whole by update
+    rs_chunk_job* done;
+};
+
+static void heap_sift_down(rs_chunk_job** heap, u32 n, u32 i) {
+    for (;;) {
+        u32 smallest = i;
+        u32 l = 2 * i + 1;
+        u32 r = 2 * i + 2;
+        if (l < n && heap[l]->priority < heap[smallest]->priority) smallest = l;
+        if (r < n && heap[r]->priority < heap[smallest]->priority) smallest = r;
+        if (smallest == i) return;
+        rs_chunk_job* t = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = t;
+        i = smallest;
+    }
+}
+
+static rs_chunk_job* heap_pop(rs_chunk_scheduler* s) {
+    rs_chunk_job* top = s->heap[0];
+    s->heap[0] = s->heap[--s->heap_count];
+    heap_sift_down(s->heap, s->heap_count, 0);
+    return top;
+}
+
+static void push_done(rs_chunk_scheduler* s, rs_chunk_job* job) {
+    rs_chunk_job* head = __atomic_load_n(&s->done, __ATOMIC_RELAXED);
+    do {
+        job->next = head;
+    } while (!__atomic_compare_exchange_n(&s->done, &head, job, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static void* worker_main(void* arg) {
+    rs_chunk_scheduler* s = arg;
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        while (!s->shutdown && s->heap_count == 0) {
+            pthread_cond_wait(&s->work_ready, &s->lock);
+        }
+        if (s->shutdown) {
+            pthread_mutex_unlock(&s->lock);
+            break;
+        }
+        rs_chunk_job* job = heap_pop(s);
+        job->state = JOB_RUNNING;
+        pthread_mutex_unlock(&s->lock);
+
+        if (!__atomic_load_n(&job->cancelled, __ATOMIC_RELAXED)) {
+            job->map = rs_chunks_generate(s->chunks, job->cx, job->cy, s->serial);
+        }
+        push_done(s, job);
+    }
+    return NULL;
+}
+
+rs_chunk_scheduler* rs_make_chunk_scheduler(rs_chunks* c, u32 num_threads) {
+    if (num_threads == 0) num_threads = 1;
+
+    rs_chunk_scheduler* s = calloc(1, sizeof(rs_chunk_scheduler));
+    s->chunks = c;
+    s->num_threads = num_threads;
+    s->threads = calloc(num_threads, sizeof(pthread_t));
+    s->serial = rs_make_pool(1);
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->work_ready, NULL);
+
+    for (u32 i = 0; i < num_threads; i++) {
+        pthread_create(&s->threads[i], NULL, worker_main, s);
+    }
+    return s;
+}
+
+static void free_job(rs_chunk_job* job) {
+    if (job->map != NULL) rs_free_grid(job->map);
+    free(job);
+}
+
+void rs_free_chunk_scheduler(rs_chunk_scheduler* s) {
+    pthread_mutex_lock(&s->lock);
+    s->shutdown = 1;
+    pthread_cond_broadcast(&s->work_ready);
+    pthread_mutex_unlock(&s->lock);
+
+    for (u32 i = 0; i < s->num_threads; i++) {
+        pthread_join(s->threads[i], NULL);
+    }
+
+    // the workers are gone, every job is in live whatever its state
+    for (u32 i = 0; i < s->live_count; i++) {
+        free_job(s->live[i]);
+    }
+
+    pthread_cond_destroy(&s->work_ready);
+    pthread_mutex_destroy(&s->lock);
+    rs_free_pool(s->serial);
+    free(s->heap);
+    free(s->live);
+    free(s->threads);
+    free(s);
+}
+
+static rs_chunk_job* find_live(rs_chunk_scheduler* s, int cx, int cy) {
+    for (u32 i = 0; i < s->live_count; i++) {
+        if (s->live[i]->cx == cx && s->live[i]->cy == cy) return s->live[i];
+    }
+    return NULL;
+}
+
+static void remove_live(rs_chunk_scheduler* s, rs_chunk_job* job) {
+    for (u32 i = 0; i < s->live_count; i++) {
+        if (s->live[i] == job) {
+            s->live[i] = s->live[--s->live_count];
+            return;
+        }
+    }
+}
+
+static void collect(rs_chunk_scheduler* s) {
+    rs_chunk_job* job = __atomic_exchange_n(&s->done, NULL, __ATOMIC_ACQUIRE);
+    while (job != NULL) {
+        rs_chunk_job* next = job->next;
+        remove_live(s, job);
+        if (!__atomic_load_n(&job->cancelled, __ATOMIC_RELAXED) && job->map != NULL) {
+            rs_chunks_insert(s->chunks, job->cx, job->cy, job->map);
+            job->map = NULL;
+        }
+        free_job(job);
+        job = next;
+    }
+}
+
+void rs_chunk_scheduler_update(rs_chunk_scheduler* s, float x, float y, float radius) {
+    rs_chunks* c = s->chunks;
+    rs_chunk_request* requests;
+    u32 n = rs_chunks_requests(c, x, y, radius, &requests);
+
+    c->stamp++;
+    c->updating = 1;
+
+    // the workers only hold the lock to pop a job, so this never waits on
+    // generation
+    pthread_mutex_lock(&s->lock);
+
+    u32 num_new = 0;
+    rs_chunk_job** fresh = malloc((n > 0 ? n : 1) * sizeof(rs_chunk_job*));
+    for (u32 i = 0; i < n; i++) {
+        rs_chunk* k = rs_chunks_find(c, requests[i].cx, requests[i].cy);
+        if (k != NULL) {
+            rs_chunks_get(c, k->cx, k->cy);
+            continue;
+        }
+        rs_chunk_job* job = find_live(s, requests[i].cx, requests[i].cy);
+        if (job == NULL) {
+            job = calloc(1, sizeof(rs_chunk_job));
+            job->cx = requests[i].cx;
+            job->cy = requests[i].cy;
+            if (s->live_count == s->live_capacity) {
+                s->live_capacity = s->live_capacity ? s->live_capacity * 2 : 64;
+                s->live = realloc(s->live, s->live_capacity * sizeof(rs_chunk_job*));
+            }
+            s->live[s->live_count++] = job;
+            fresh[num_new++] = job;
+        }
+        // wanted again before a cancelled job got to run or finish
+        __atomic_store_n(&job->cancelled, 0, __ATOMIC_RELAXED);
+        job->priority = requests[i].d2;
+        job->stamp = c->stamp;
+    }
+    free(requests);
+
+    // drop queued jobs that went out of view, flag running ones
+    u32 kept = 0;
+    for (u32 i = 0; i < s->heap_count; i++) {
+        rs_chunk_job* job = s->heap[i];
+        if (job->stamp == c->stamp) {
+            s->heap[kept++] = job;
+        }
+        else {
+            remove_live(s, job);
+            free_job(job);
+        }
+    }
+    s->heap_count = kept;
+    for (u32 i = 0; i < s->live_count; i++) {
+        rs_chunk_job* job = s->live[i];
+        if (job->state == JOB_RUNNING && job->stamp != c->stamp) {
+            __atomic_store_n(&job->cancelled, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    // queue the new jobs and restore the heap order after the reprioritising
+    if (s->heap_count + num_new > s->heap_capacity) {
+        s->heap_capacity = s->heap_count + num_new > 64 ? (s->heap_count + num_new) * 2 : 64;
+        s->heap = realloc(s->heap, s->heap_capacity * sizeof(rs_chunk_job*));
+    }
+    for (u32 i = 0; i < num_new; i++) {
+        fresh[i]->state = JOB_QUEUED;
+        s->heap[s->heap_count++] = fresh[i];
+    }
+    for (u32 i = s->heap_count / 2; i-- > 0;) {
+        heap_sift_down(s->heap, s->heap_count, i);
+    }
+    if (s->heap_count > 0) {
+        pthread_cond_broadcast(&s->work_ready);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    free(fresh);
+    collect(s);
+    c->updating = 0;
+}
+
+u32 rs_chunk_scheduler_pending(rs_chunk_scheduler* s) {
+    return s->live_count;
+}
@@ -0,0 +1,27 @@
+#ifndef RS_SCHEDULER_H
+#define RS_SCHEDULER_H
+
+#include "rs_chunks.h"
+
+//
+// background chunk generation. worker threads take jobs from a priority
+// queue ordered by distance to the camera and hand finished maps back
+// through a lock-free completion stack, so the thread calling
+// rs_chunk_scheduler_update never waits on noise. jobs that drop out of
+// view are removed from the queue, or flagged when already running and
+// thrown away on completion.
+//
+typedef struct rs_chunk_scheduler rs_chunk_scheduler;
+
+rs_chunk_scheduler* rs_make_chunk_scheduler(rs_chunks* c, u32 num_threads);
+// cancels outstanding jobs and joins the workers, cached chunks stay in c
+void rs_free_chunk_scheduler(rs_chunk_scheduler* s);
+
+// queues the missing chunks within radius cells of (x, y), reprioritises
+// or cancels queued ones and caches the maps finished since the last call.
+// chunks show up in rs_chunks_find() as they complete
+void rs_chunk_scheduler_update(rs_chunk_scheduler* s, float x, float y, float radius);
+// jobs queued or running
+u32 rs_chunk_scheduler_pending(rs_chunk_scheduler* s);
+
+#endif
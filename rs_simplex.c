@@ -0,0 +1,450 @@
+// Simplex noise, after simplexnoise1234 by Stefan Gustavson (public
+// domain, stefan.gustavson@liu.se). The skewing factors, kernel radii and
+// final scales are his, the permutation tables and gradient functions are
+// the ones of rs_perlin.c so seeded contexts work with either engine.
+
+#include <math.h>
+#include "rs_simplex.h"
+#include "rs_noise_internal.h"
+
+// a true floor, unlike the one in rs_perlin.c, integer points belong to
+// the simplex they start
+#define FASTFLOOR(x) ( ((int)(x)<=(x)) ? ((int)x) : (((int)x)-1) )
+
+// skewing and unskewing factors, (sqrt(n+1)-1)/n and (n+1-sqrt(n+1))/(n(n+1))
+#define F2 0.366025403f
+#define G2 0.211324865f
+#define F3 0.333333333f
+#define G3 0.166666667f
+#define F4 0.309016994f
+#define G4 0.138196601f
+
+#define TWO_PI 6.28318530718f
+
+//---------------------------------------------------------------------
+/** 1D simplex noise
+ */
+float snoise1_ctx( const rs_noise* ctx, float x )
+{
+    const unsigned char* perm = ctx->perm;
+    int i0 = FASTFLOOR( x );
+    int i1 = i0 + 1;
+    float x0 = x - i0;
+    float x1 = x0 - 1.0f;
+    float n0, n1;
+
+    float t0 = 1.0f - x0*x0;
+    t0 *= t0;
+    n0 = t0 * t0 * grad1( perm[ i0 & 0xff ], x0 );
+
+    float t1 = 1.0f - x1*x1;
+    t1 *= t1;
+    n1 = t1 * t1 * grad1( perm[ i1 & 0xff ], x1 );
+
+    // the maximum value of this noise is 8*(3/4)^4 = 2.53125, a factor
+    // of 0.395 scales it to fit exactly within [-1,1]
+    return 0.395f * ( n0 + n1 );
+}
+
+//---------------------------------------------------------------------
+/** 2D simplex noise
+ */
+float snoise2_ctx( const rs_noise* ctx, float x, float y )
+{
+    const unsigned char* perm = ctx->perm;
+    float n0, n1, n2; // Noise contributions from the three corners
+
+    // Skew the input space to determine which simplex cell we're in
+    float s = ( x + y ) * F2;
+    float xs = x + s;
+    float ys = y + s;
+    int i = FASTFLOOR( xs );
+    int j = FASTFLOOR( ys );
+
+    float t = (float)( i + j ) * G2;
+    float X0 = i - t; // Unskew the cell origin back to (x,y) space
+    float Y0 = j - t;
+    float x0 = x - X0; // The x,y distances from the cell origin
+    float y0 = y - Y0;
+
+    // The simplex is an equilateral triangle, lower when x0 > y0
+    int i1, j1;
+    if( x0 > y0 ) { i1 = 1; j1 = 0; }
+    else { i1 = 0; j1 = 1; }
+
+    float x1 = x0 - i1 + G2; // Offsets for middle corner in (x,y) unskewed coords
+    float y1 = y0 - j1 + G2;
+    float x2 = x0 - 1.0f + 2.0f * G2; // Offsets for last corner in (x,y) unskewed coords
+    float y2 = y0 - 1.0f + 2.0f * G2;
+
+    // Wrap the integer indices at 256, to avoid indexing perm[] out of bounds
+    int ii = i & 0xff;
+    int jj = j & 0xff;
+
+    float t0 = 0.5f - x0*x0 - y0*y0;
+    if( t0 < 0.0f ) n0 = 0.0f;
+    else {
+        t0 *= t0;
+        n0 = t0 * t0 * grad2( perm[ ii + perm[ jj ] ], x0, y0 );
+    }
+
+    float t1 = 0.5f - x1*x1 - y1*y1;
+    if( t1 < 0.0f ) n1 = 0.0f;
+    else {
+        t1 *= t1;
+        n1 = t1 * t1 * grad2( perm[ ii + i1 + perm[ jj + j1 ] ], x1, y1 );
+    }
+
+    float t2 = 0.5f - x2*x2 - y2*y2;
+    if( t2 < 0.0f ) n2 = 0.0f;
+    else {
+        t2 *= t2;
+        n2 = t2 * t2 * grad2( perm[ ii + 1 + perm[ jj + 1 ] ], x2, y2 );
+    }
+
+    // scaled to return values roughly in [-1,1]
+    return 40.0f * ( n0 + n1 + n2 );
+}
+
+//---------------------------------------------------------------------
+/** 3D simplex noise
+ */
+float snoise3_ctx( const rs_noise* ctx, float x, float y, float z )
+{
+    const unsigned char* perm = ctx->perm;
+    float n0, n1, n2, n3; // Noise contributions from the four corners
+
+    float s = ( x + y + z ) * F3;
+    float xs = x + s;
+    float ys = y + s;
+    float zs = z + s;
+    int i = FASTFLOOR( xs );
+    int j = FASTFLOOR( ys );
+    int k = FASTFLOOR( zs );
+
+    float t = (float)( i + j + k ) * G3;
+    float X0 = i - t;
+    float Y0 = j - t;
+    float Z0 = k - t;
+    float x0 = x - X0;
+    float y0 = y - Y0;
+    float z0 = z - Z0;
+
+    // The simplex is one of six tetrahedra, picked by the order of x0, y0, z0.
+    // (i1,j1,k1) and (i2,j2,k2) are the offsets of its second and third corner
+    int i1, j1, k1;
+    int i2, j2, k2;
+
+    if( x0 >= y0 ) {
+        if( y0 >= z0 ) { i1=1; j1=0; k1=0; i2=1; j2=1; k2=0; } // X Y Z order
+        else if( x0 >= z0 ) { i1=1; j1=0; k1=0; i2=1; j2=0; k2=1; } // X Z Y order
+        else { i1=0; j1=0; k1=1; i2=1; j2=0; k2=1; } // Z X Y order
+    }
+    else { // x0<y0
+        if( y0 < z0 ) { i1=0; j1=0; k1=1; i2=0; j2=1; k2=1; } // Z Y X order
+        else if( x0 < z0 ) { i1=0; j1=1; k1=0; i2=0; j2=1; k2=1; } // Y Z X order
+        else { i1=0; j1=1; k1=0; i2=1; j2=1; k2=0; } // Y X Z order
+    }
+
+    float x1 = x0 - i1 + G3;
+    float y1 = y0 - j1 + G3;
+    float z1 = z0 - k1 + G3;
+    float x2 = x0 - i2 + 2.0f * G3;
+    float y2 = y0 - j2 + 2.0f * G3;
+    float z2 = z0 - k2 + 2.0f * G3;
+    float x3 = x0 - 1.0f + 3.0f * G3;
+    float y3 = y0 - 1.0f + 3.0f * G3;
+    float z3 = z0 - 1.0f + 3.0f * G3;
+
+    int ii = i & 0xff;
+    int jj = j & 0xff;
+    int kk = k & 0xff;
+
+    float t0 = 0.6f - x0*x0 - y0*y0 - z0*z0;
+    if( t0 < 0.0f ) n0 = 0.0f;
+    else {
+        t0 *= t0;
+        n0 = t0 * t0 * grad3( perm[ ii + perm[ jj + perm[ kk ] ] ], x0, y0, z0 );
+    }
+
+    float t1 = 0.6f - x1*x1 - y1*y1 - z1*z1;
+    if( t1 < 0.0f ) n1 = 0.0f;
+    else {
+        t1 *= t1;
+        n1 = t1 * t1 * grad3( perm[ ii + i1 + perm[ jj + j1 + perm[ kk + k1 ] ] ], x1, y1, z1 );
+    }
+
+    float t2 = 0.6f - x2*x2 - y2*y2 - z2*z2;
+    if( t2 < 0.0f ) n2 = 0.0f;
+    else {
+        t2 *= t2;
+        n2 = t2 * t2 * grad3( perm[ ii + i2 + perm[ jj + j2 + perm[ kk + k2 ] ] ], x2, y2, z2 );
+    }
+
+    float t3 = 0.6f - x3*x3 - y3*y3 - z3*z3;
+    if( t3 < 0.0f ) n3 = 0.0f;
+    else {
+        t3 *= t3;
+        n3 = t3 * t3 * grad3( perm[ ii + 1 + perm[ jj + 1 + perm[ kk + 1 ] ] ], x3, y3, z3 );
+    }
+
+    // scaled to stay just inside [-1,1]
+    return 32.0f * ( n0 + n1 + n2 + n3 );
+}
+
+//---------------------------------------------------------------------
+/** 4D simplex noise
+ */
+float snoise4_ctx( const rs_noise* ctx, float x, float y, float z, float w )
+{
+    const unsigned char* perm = ctx->perm;
+    float n0, n1, n2, n3, n4; // Noise contributions from the five corners
+
+    float s = ( x + y + z + w ) * F4;
+    float xs = x + s;
+    float ys = y + s;
+    float zs = z + s;
+    float ws = w + s;
+    int i = FASTFLOOR( xs );
+    int j = FASTFLOOR( ys );
+    int k = FASTFLOOR( zs );
+    int l = FASTFLOOR( ws );
+
+    float t = (float)( i + j + k + l ) * G4;
+    float X0 = i - t;
+    float Y0 = j - t;
+    float Z0 = k - t;
+    float W0 = l - t;
+    float x0 = x - X0;
+    float y0 = y - Y0;
+    float z0 = z - Z0;
+    float w0 = w - W0;
+
+    // The simplex is one of 24 pentatopes, picked by the order of x0..w0.
+    // Each coordinate's rank is how many of the others it is larger than,
+    // the corners step along the coordinates from the largest down.
+    int rankx = 0;
+    int ranky = 0;
+    int rankz = 0;
+    int rankw = 0;
+    if( x0 > y0 ) rankx++; else ranky++;
+    if( x0 > z0 ) rankx++; else rankz++;
+    if( x0 > w0 ) rankx++; else rankw++;
+    if( y0 > z0 ) ranky++; else rankz++;
+    if( y0 > w0 ) ranky++; else rankw++;
+    if( z0 > w0 ) rankz++; else rankw++;
+
+    int i1 = rankx >= 3, j1 = ranky >= 3, k1 = rankz >= 3, l1 = rankw >= 3;
+    int i2 = rankx >= 2, j2 = ranky >= 2, k2 = rankz >= 2, l2 = rankw >= 2;
+    int i3 = rankx >= 1, j3 = ranky >= 1, k3 = rankz >= 1, l3 = rankw >= 1;
+
+    float x1 = x0 - i1 + G4;
+    float y1 = y0 - j1 + G4;
+    float z1 = z0 - k1 + G4;
+    float w1 = w0 - l1 + G4;
+    float x2 = x0 - i2 + 2.0f * G4;
+    float y2 = y0 - j2 + 2.0f * G4;
+    float z2 = z0 - k2 + 2.0f * G4;
+    float w2 = w0 - l2 + 2.0f * G4;
+    float x3 = x0 - i3 + 3.0f * G4;
+    float y3 = y0 - j3 + 3.0f * G4;
+    float z3 = z0 - k3 + 3.0f * G4;
+    float w3 = w0 - l3 + 3.0f * G4;
+    float x4 = x0 - 1.0f + 4.0f * G4;
+    float y4 = y0 - 1.0f + 4.0f * G4;
+    float z4 = z0 - 1.0f + 4.0f * G4;
+    float w4 = w0 - 1.0f + 4.0f * G4;
+
+    int ii = i & 0xff;
+    int jj = j & 0xff;
+    int kk = k & 0xff;
+    int ll = l & 0xff;
+
+    float t0 = 0.6f - x0*x0 - y0*y0 - z0*z0 - w0*w0;
+    if( t0 < 0.0f ) n0 = 0.0f;
+    else {
+        t0 *= t0;
+        n0 = t0 * t0 * grad4( perm[ ii + perm[ jj + perm[ kk + perm[ ll ] ] ] ], x0, y0, z0, w0 );
+    }
+
+    float t1 = 0.6f - x1*x1 - y1*y1 - z1*z1 - w1*w1;
+    if( t1 < 0.0f ) n1 = 0.0f;
+    else {
+        t1 *= t1;
+        n1 = t1 * t1 * grad4( perm[ ii + i1 + perm[ jj + j1 + perm[ kk + k1 + perm[ ll + l1 ] ] ] ], x1, y1, z1, w1 );
+    }
+
+    float t2 = 0.6f - x2*x2 - y2*y2 - z2*z2 - w2*w2;
+    if( t2 < 0.0f ) n2 = 0.0f;
+    else {
+        t2 *= t2;
+        n2 = t2 * t2 * grad4( perm[ ii + i2 + perm[ jj + j2 + perm[ kk + k2 + perm[ ll + l2 ] ] ] ], x2, y2, z2, w2 );
+    }
+
+    float t3 = 0.6f - x3*x3 - y3*y3 - z3*z3 - w3*w3;
+    if( t3 < 0.0f ) n3 = 0.0f;
+    else {
+        t3 *= t3;
+        n3 = t3 * t3 * grad4( perm[ ii + i3 + perm[ jj + j3 + perm[ kk + k3 + perm[ ll + l3 ] ] ] ], x3, y3, z3, w3 );
+    }
+
+    float t4 = 0.6f - x4*x4 - y4*y4 - z4*z4 - w4*w4;
+    if( t4 < 0.0f ) n4 = 0.0f;
+    else {
+        t4 *= t4;
+        n4 = t4 * t4 * grad4( perm[ ii + 1 + perm[ jj + 1 + perm[ kk + 1 + perm[ ll + 1 ] ] ] ], x4, y4, z4, w4 );
+    }
+
+    // scaled to stay just inside [-1,1]
+    return 27.0f * ( n0 + n1 + n2 + n3 + n4 );
+}
+
+//---------------------------------------------------------------------
+/** Periodic simplex noise. x goes once around a circle of circumference
+ *  px, so features keep their size, and 2D takes the product of two such
+ *  circles in 4D.
+ */
+
+// 2D noise of a point on the torus with periods px and py, which don't
+// have to be integers
+static float torus4( const rs_noise* ctx, float x, float y, float px, float py )
+{
+    float ax = x * ( TWO_PI / px );
+    float ay = y * ( TWO_PI / py );
+    float rx = px / TWO_PI;
+    float ry = py / TWO_PI;
+    return snoise4_ctx( ctx, rx * cosf( ax ), rx * sinf( ax ), ry * cosf( ay ), ry * sinf( ay ) );
+}
+
+float psnoise1_ctx( const rs_noise* ctx, float x, int px )
+{
+    float a = x * ( TWO_PI / px );
+    float r = px / TWO_PI;
+    return snoise2_ctx( ctx, r * cosf( a ), r * sinf( a ) );
+}
+
+float psnoise2_ctx( const rs_noise* ctx, float x, float y, int px, int py )
+{
+    return torus4( ctx, x, y, (float)px, (float)py );
+}
+
+//---------------------------------------------------------------------
+// fBm
+
+float csnoise2_ctx(const rs_noise* ctx, float x, float y, int octaves, float persistence, float lacunarity) {
+    float total = 0;
+    float frequency = 1.0;
+    float amplitude = 1.0;
+    float maxValue = 0;
+
+    for (int i = 0; i < octaves; i++) {
+        total += snoise2_ctx(ctx, x * frequency, y * frequency) * amplitude;
+        maxValue += amplitude;
+        amplitude *= persistence;
+        frequency *= lacunarity;
+    }
+
+    return total / maxValue;
+}
+
+float csnoise3_ctx(const rs_noise* ctx, float x, float y, float z, int octaves, float persistence, float lacunarity) {
+    float total = 0;
+    float frequency = 1.0;
+    float amplitude = 1.0;
+    float maxValue = 0;
+
+    for (int i = 0; i < octaves; i++) {
+        total += snoise3_ctx(ctx, x * frequency, y * frequency, z * frequency) * amplitude;
+        maxValue += amplitude;
+        amplitude *= persistence;
+        frequency *= lacunarity;
+    }
+
+    return total / maxValue;
+}
+
+float csnoise4_ctx(const rs_noise* ctx, float x, float y, float z, float w,
+                   int octaves, float persistence, float lacunarity) {
+    float total = 0;
+    float frequency = 1.0;
+    float amplitude = 1.0;
+    float maxValue = 0;
+
+    for (int i = 0; i < octaves; i++) {
+        total += snoise4_ctx(ctx, x * frequency, y * frequency, z * frequency, w * frequency) * amplitude;
+        maxValue += amplitude;
+        amplitude *= persistence;
+        frequency *= lacunarity;
+    }
+
+    return total / maxValue;
+}
+
+// each octave is a torus of its own, scaled by the frequency
+float cpsnoise2_ctx(const rs_noise* ctx, float x, float y, int px, int py,
+                    int octaves, float persistence, float lacunarity) {
+    float total = 0;
+    float frequency = 1.0;
+    float amplitude = 1.0;
+    float maxValue = 0;
+
+    for (int i = 0; i < octaves; i++) {
+        total += torus4(ctx, x * frequency, y * frequency, px * frequency, py * frequency) * amplitude;
+        maxValue += amplitude;
+        amplitude *= persistence;
+        frequency *= lacunarity;
+    }
+
+    return total / maxValue;
+}
+
+float csnoise2_filtered_ctx(const rs_noise* ctx, float x, float y, float footprint,
+                            int octaves, float persistence, float lacunarity) {
+    float total = 0;
+    float frequency = 1.0;
+    float amplitude = 1.0;
+    float maxValue = 0;
+
+    for (int i = 0; i < octaves; i++) {
+        float weight = fbm_octave_weight(frequency, footprint);
+        if (weight > 0) {
+            total += snoise2_ctx(ctx, x * frequency, y * frequency) * (amplitude * weight);
+        }
+        maxValue += amplitude;
+        amplitude *= persistence;
+        frequency *= lacunarity;
+    }
+
+    return total / maxValue;
+}
+
+//---------------------------------------------------------------------
+// reference table versions
+
+float snoise1( float x ) { return snoise1_ctx( rs_default_noise(), x ); }
+float snoise2( float x, float y ) { return snoise2_ctx( rs_default_noise(), x, y ); }
+float snoise3( float x, float y, float z ) { return snoise3_ctx( rs_default_noise(), x, y, z ); }
+float snoise4( float x, float y, float z, float w ) { return snoise4_ctx( rs_default_noise(), x, y, z, w ); }
+
+float psnoise1( float x, int px ) { return psnoise1_ctx( rs_default_noise(), x, px ); }
+float psnoise2( float x, float y, int px, int py ) { return psnoise2_ctx( rs_default_noise(), x, y, px, py ); }
+
+float csnoise2(float x, float y, int octaves, float persistence, float lacunarity) {
+    return csnoise2_ctx(rs_default_noise(), x, y, octaves, persistence, lacunarity);
+}
+
+float csnoise3(float x, float y, float z, int octaves, float persistence, float lacunarity) {
+    return csnoise3_ctx(rs_default_noise(), x, y, z, octaves, persistence, lacunarity);
+}
+
+float csnoise4(float x, float y, float z, float w, int octaves, float persistence, float lacunarity) {
+    return csnoise4_ctx(rs_default_noise(), x, y, z, w, octaves, persistence, lacunarity);
+}
+
+float cpsnoise2(float x, float y, int px, int py, int octaves, float persistence, float lacunarity) {
+    return cpsnoise2_ctx(rs_default_noise(), x, y, px, py, octaves, persistence, lacunarity);
+}
+
+float csnoise2_filtered(float x, float y, float footprint, int octaves, float persistence, float lacunarity) {
+    return csnoise2_filtered_ctx(rs_default_noise(), x, y, footprint, octaves, persistence, lacunarity);
+}
@@ -0,0 +1,83 @@
+#ifndef RS_SIMPLEX_H
+#define RS_SIMPLEX_H
+
+/*
+ * Simplex noise in 1D to 4D, after Stefan Gustavson's public domain
+ * simplexnoise1234, sharing the rs_noise permutation tables and gradient
+ * sets of the Perlin noise in rs_perlin.c.
+ *
+ * A sample sums the contributions of the N + 1 corners of the simplex it
+ * falls in instead of the 2^N corners of a cube, 3 instead of 4 in 2D, 4
+ * instead of 8 in 3D and 5 instead of 16 in 4D, which is what makes
+ * animated 3D and 4D fields affordable. Values are roughly in [-1, 1],
+ * with a little more contrast than noise2/noise3, and the lattice is
+ * skewed so axis aligned artifacts are less visible.
+ */
+
+#include "rs_perlin.h"
+
+extern float snoise1( float x );
+extern float snoise2( float x, float y );
+extern float snoise3( float x, float y, float z );
+extern float snoise4( float x, float y, float z, float w );
+
+/** Periodic simplex noise, 1D on a circle through 2D noise and 2D on a
+ *  torus through 4D noise, so the lattice doesn't have to line up with
+ *  the period. There is no 3D form, it would take 6D noise.
+ */
+extern float psnoise1( float x, int px );
+extern float psnoise2( float x, float y, int px, int py );
+
+/** fBm of the above, normalized like cnoise2. Every octave of cpsnoise2
+ *  repeats over (px, py) whatever the lacunarity.
+ */
+extern float csnoise2(float x, float y, int octaves, float persistence, float lacunarity);
+extern float csnoise3(float x, float y, float z, int octaves, float persistence, float lacunarity);
+extern float csnoise4(float x, float y, float z, float w, int octaves, float persistence, float lacunarity);
+extern float cpsnoise2(float x, float y, int px, int py, int octaves, float persistence, float lacunarity);
+// band limited like cnoise2_filtered()
+extern float csnoise2_filtered(float x, float y, float footprint, int octaves, float persistence, float lacunarity);
+
+/** Batch versions, vectorized with AVX2 when the CPU has it.
+ */
+extern void snoise2_batch(const float* x, const float* y, float* out, int n);
+extern void snoise3_batch(const float* x, const float* y, const float* z, float* out, int n);
+extern void snoise4_batch(const float* x, const float* y, const float* z, const float* w, float* out, int n);
+extern void csnoise2_batch(const float* x, const float* y, float* out, int n, int octaves, float persistence, float lacunarity);
+extern void csnoise3_batch(const float* x, const float* y, const float* z, float* out, int n,
+                           int octaves, float persistence, float lacunarity);
+extern void csnoise4_batch(const float* x, const float* y, const float* z, const float* w, float* out, int n,
+                           int octaves, float persistence, float lacunarity);
+
+/** The above with an explicit context
+ */
+extern float snoise1_ctx( const rs_noise* ctx, float x );
+extern float snoise2_ctx( const rs_noise* ctx, float x, float y );
+extern float snoise3_ctx( const rs_noise* ctx, float x, float y, float z );
+extern float snoise4_ctx( const rs_noise* ctx, float x, float y, float z, float w );
+
+extern float psnoise1_ctx( const rs_noise* ctx, float x, int px );
+extern float psnoise2_ctx( const rs_noise* ctx, float x, float y, int px, int py );
+
+extern float csnoise2_ctx(const rs_noise* ctx, float x, float y, int octaves, float persistence, float lacunarity);
+extern float csnoise3_ctx(const rs_noise* ctx, float x, float y, float z, int octaves, float persistence, float lacunarity);
+extern float csnoise4_ctx(const rs_noise* ctx, float x, float y, float z, float w,
+                          int octaves, float persistence, float lacunarity);
+extern float cpsnoise2_ctx(const rs_noise* ctx, float x, float y, int px, int py,
+                           int octaves, float persistence, float lacunarity);
+extern float csnoise2_filtered_ctx(const rs_noise* ctx, float x, float y, float footprint,
+                                   int octaves, float persistence, float lacunarity);
+
+extern void snoise2_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, int n);
+extern void snoise3_batch_ctx(const rs_noise* ctx, const float* x, const float* y, const float* z, float* out, int n);
+extern void snoise4_batch_ctx(const rs_noise* ctx, const float* x, const float* y, const float* z, const float* w,
+                              float* out, int n);
+extern void csnoise2_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, int n,
+                               int octaves, float persistence, float lacunarity);
+extern void csnoise3_batch_ctx(const rs_noise* ctx, const float* x, const float* y, const float* z, float* out, int n,
+                               int octaves, float persistence, float lacunarity);
+extern void csnoise4_batch_ctx(const rs_noise* ctx, const float* x, const float* y, const float* z, const float* w,
+                               float* out, int n, int octaves, float persistence, float lacunarity);
+extern void csnoise2_filtered_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, int n,
+                                        float footprint, int octaves, float persistence, float lacunarity);
+#endif
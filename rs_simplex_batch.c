@@ -0,0 +1,441 @@
+// Batch evaluation of the simplex noise in rs_simplex.c.
+//
+// Like rs_perlin_batch.c, each kernel evaluates 8 points at a time with
+// the same float operations, in the same order, as the scalar code. The
+// simplex a lane falls in is picked with compares instead of branches,
+// corners outside their kernel radius are masked to 0 rather than
+// skipped, and the fBm loops run over an rs_octave_plan.
+//
+// AVX2 only, AVX-512 CPUs run the AVX2 kernels. The file builds without
+// any -m flags and points past the last full vector use the scalar code.
+
+#include <immintrin.h>
+#include "rs_simplex.h"
+
+#define AVX2 __attribute__((target("avx2")))
+
+#define F2 0.366025403f
+#define G2 0.211324865f
+#define F3 0.333333333f
+#define G3 0.166666667f
+#define F4 0.309016994f
+#define G4 0.138196601f
+
+//---------------------------------------------------------------------
+// AVX2, 8 lanes
+
+AVX2 static inline __m256i floor8(__m256 x) {
+    // trunc(x) when trunc(x) <= x, otherwise trunc(x) - 1
+    __m256i t = _mm256_cvttps_epi32(x);
+    __m256i gt = _mm256_castps_si256(_mm256_cmp_ps(_mm256_cvtepi32_ps(t), x, _CMP_GT_OQ));
+    return _mm256_add_epi32(t, gt);
+}
+
+AVX2 static inline __m256i perm8(const unsigned char* p, __m256i i) {
+    return _mm256_and_si256(_mm256_i32gather_epi32((const int*)p, i, 1), _mm256_set1_epi32(0xff));
+}
+
+// 1 in the lanes of a compare mask, as int and as float
+AVX2 static inline __m256i one8(__m256 mask) {
+    return _mm256_and_si256(_mm256_castps_si256(mask), _mm256_set1_epi32(1));
+}
+
+AVX2 static inline __m256 onef8(__m256 mask) {
+    return _mm256_and_ps(mask, _mm256_set1_ps(1.0f));
+}
+
+// xor mask that flips the sign of a lane when the given hash bit is set
+AVX2 static inline __m256 sign8(__m256i h, int bit) {
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1 << bit)), 31 - bit));
+}
+
+AVX2 static inline __m256 grad2_8(__m256i hash, __m256 x, __m256 y) {
+    __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(7));
+    __m256 lt4 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(h, _mm256_set1_epi32(4)), _mm256_setzero_si256()));
+    __m256 u = _mm256_blendv_ps(y, x, lt4);
+    __m256 v = _mm256_blendv_ps(x, y, lt4);
+    v = _mm256_add_ps(v, v);
+    return _mm256_add_ps(_mm256_xor_ps(u, sign8(h, 0)), _mm256_xor_ps(v, sign8(h, 1)));
+}
+
+AVX2 static inline __m256 grad3_8(__m256i hash, __m256 x, __m256 y, __m256 z) {
+    __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+    __m256 lt8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+    __m256 lt4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    // h == 12 || h == 14
+    __m256 hx = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(h, _mm256_set1_epi32(13)), _mm256_set1_epi32(12)));
+    __m256 u = _mm256_blendv_ps(y, x, lt8);
+    __m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, hx), y, lt4);
+    return _mm256_add_ps(_mm256_xor_ps(u, sign8(h, 0)), _mm256_xor_ps(v, sign8(h, 1)));
+}
+
+AVX2 static inline __m256 grad4_8(__m256i hash, __m256 x, __m256 y, __m256 z, __m256 t) {
+    __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(31));
+    __m256 lt24 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(24), h));
+    __m256 lt16 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(16), h));
+    __m256 lt8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+    __m256 u = _mm256_blendv_ps(y, x, lt24);
+    __m256 v = _mm256_blendv_ps(z, y, lt16);
+    __m256 w = _mm256_blendv_ps(t, z, lt8);
+    __m256 uv = _mm256_add_ps(_mm256_xor_ps(u, sign8(h, 0)), _mm256_xor_ps(v, sign8(h, 1)));
+    return _mm256_add_ps(uv, _mm256_xor_ps(w, sign8(h, 2)));
+}
+
+// t^4 of a corner with t = r2 - |d|^2, 0 where t < 0, to be multiplied by
+// the gradient term
+AVX2 static inline __m256 falloff8(__m256 t, __m256* live) {
+    *live = _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_NLT_UQ);
+    t = _mm256_mul_ps(t, t);
+    return _mm256_mul_ps(t, t);
+}
+
+AVX2 static inline __m256 corner2_8(const unsigned char* p, __m256i ii, __m256i jj, __m256 x, __m256 y) {
+    __m256 t = _mm256_set1_ps(0.5f);
+    t = _mm256_sub_ps(t, _mm256_mul_ps(x, x));
+    t = _mm256_sub_ps(t, _mm256_mul_ps(y, y));
+    __m256 live;
+    __m256 t4 = falloff8(t, &live);
+    __m256i h = perm8(p, _mm256_add_epi32(ii, perm8(p, jj)));
+    return _mm256_and_ps(live, _mm256_mul_ps(t4, grad2_8(h, x, y)));
+}
+
+AVX2 static __m256 simplex2_8(const unsigned char* p, __m256 x, __m256 y) {
+    __m256i mask = _mm256_set1_epi32(0xff);
+    __m256i one = _mm256_set1_epi32(1);
+    __m256 onef = _mm256_set1_ps(1.0f);
+
+    __m256 s = _mm256_mul_ps(_mm256_add_ps(x, y), _mm256_set1_ps(F2));
+    __m256i i = floor8(_mm256_add_ps(x, s));
+    __m256i j = floor8(_mm256_add_ps(y, s));
+    __m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(i, j)), _mm256_set1_ps(G2));
+    __m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(_mm256_cvtepi32_ps(i), t));
+    __m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(_mm256_cvtepi32_ps(j), t));
+
+    __m256 lower = _mm256_cmp_ps(x0, y0, _CMP_GT_OQ);
+    __m256i i1 = one8(lower);
+    __m256i j1 = _mm256_sub_epi32(one, i1);
+
+    __m256 g1 = _mm256_set1_ps(G2);
+    __m256 g2 = _mm256_set1_ps(2.0f * G2);
+    __m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_cvtepi32_ps(i1)), g1);
+    __m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_cvtepi32_ps(j1)), g1);
+    __m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, onef), g2);
+    __m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, onef), g2);
+
+    __m256i ii = _mm256_and_si256(i, mask);
+    __m256i jj = _mm256_and_si256(j, mask);
+
+    __m256 n0 = corner2_8(p, ii, jj, x0, y0);
+    __m256 n1 = corner2_8(p, _mm256_add_epi32(ii, i1), _mm256_add_epi32(jj, j1), x1, y1);
+    __m256 n2 = corner2_8(p, _mm256_add_epi32(ii, one), _mm256_add_epi32(jj, one), x2, y2);
+
+    return _mm256_mul_ps(_mm256_set1_ps(40.0f), _mm256_add_ps(_mm256_add_ps(n0, n1), n2));
+}
+
+AVX2 static inline __m256 corner3_8(const unsigned char* p, __m256i ii, __m256i jj, __m256i kk,
+                                    __m256 x, __m256 y, __m256 z) {
+    __m256 t = _mm256_set1_ps(0.6f);
+    t = _mm256_sub_ps(t, _mm256_mul_ps(x, x));
+    t = _mm256_sub_ps(t, _mm256_mul_ps(y, y));
+    t = _mm256_sub_ps(t, _mm256_mul_ps(z, z));
+    __m256 live;
+    __m256 t4 = falloff8(t, &live);
+    __m256i h = perm8(p, _mm256_add_epi32(ii, perm8(p, _mm256_add_epi32(jj, perm8(p, kk)))));
+    return _mm256_and_ps(live, _mm256_mul_ps(t4, grad3_8(h, x, y, z)));
+}
+
+AVX2 static __m256 simplex3_8(const unsigned char* p, __m256 x, __m256 y, __m256 z) {
+    __m256i mask = _mm256_set1_epi32(0xff);
+    __m256i one = _mm256_set1_epi32(1);
+    __m256 onef = _mm256_set1_ps(1.0f);
+
+    __m256 s = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(x, y), z), _mm256_set1_ps(F3));
+    __m256i i = floor8(_mm256_add_ps(x, s));
+    __m256i j = floor8(_mm256_add_ps(y, s));
+    __m256i k = floor8(_mm256_add_ps(z, s));
+    __m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_add_epi32(i, j), k)), _mm256_set1_ps(G3));
+    __m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(_mm256_cvtepi32_ps(i), t));
+    __m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(_mm256_cvtepi32_ps(j), t));
+    __m256 z0 = _mm256_sub_ps(z, _mm256_sub_ps(_mm256_cvtepi32_ps(k), t));
+
+    // the branches of snoise3_ctx as compares: the second corner steps
+    // along the largest coordinate, the third along all but the smallest
+    __m256 xy = _mm256_cmp_ps(x0, y0, _CMP_GE_OQ);
+    __m256 yz = _mm256_cmp_ps(y0, z0, _CMP_GE_OQ);
+    __m256 xz = _mm256_cmp_ps(x0, z0, _CMP_GE_OQ);
+    __m256 i1 = _mm256_and_ps(xy, xz);
+    __m256 j1 = _mm256_andnot_ps(xy, yz);
+    __m256 k1 = _mm256_andnot_ps(_mm256_or_ps(xz, yz), _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+    __m256 i2 = _mm256_or_ps(xy, xz);
+    __m256 j2 = _mm256_or_ps(_mm256_andnot_ps(xy, _mm256_castsi256_ps(_mm256_set1_epi32(-1))), yz);
+    __m256 k2 = _mm256_andnot_ps(_mm256_and_ps(xz, yz), _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+
+    __m256 g1 = _mm256_set1_ps(G3);
+    __m256 g2 = _mm256_set1_ps(2.0f * G3);
+    __m256 g3 = _mm256_set1_ps(3.0f * G3);
+    __m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, onef8(i1)), g1);
+    __m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, onef8(j1)), g1);
+    __m256 z1 = _mm256_add_ps(_mm256_sub_ps(z0, onef8(k1)), g1);
+    __m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, onef8(i2)), g2);
+    __m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, onef8(j2)), g2);
+    __m256 z2 = _mm256_add_ps(_mm256_sub_ps(z0, onef8(k2)), g2);
+    __m256 x3 = _mm256_add_ps(_mm256_sub_ps(x0, onef), g3);
+    __m256 y3 = _mm256_add_ps(_mm256_sub_ps(y0, onef), g3);
+    __m256 z3 = _mm256_add_ps(_mm256_sub_ps(z0, onef), g3);
+
+    __m256i ii = _mm256_and_si256(i, mask);
+    __m256i jj = _mm256_and_si256(j, mask);
+    __m256i kk = _mm256_and_si256(k, mask);
+
+    __m256 n0 = corner3_8(p, ii, jj, kk, x0, y0, z0);
+    __m256 n1 = corner3_8(p, _mm256_add_epi32(ii, one8(i1)), _mm256_add_epi32(jj, one8(j1)), _mm256_add_epi32(kk, one8(k1)),
+                          x1, y1, z1);
+    __m256 n2 = corner3_8(p, _mm256_add_epi32(ii, one8(i2)), _mm256_add_epi32(jj, one8(j2)), _mm256_add_epi32(kk, one8(k2)),
+                          x2, y2, z2);
+    __m256 n3 = corner3_8(p, _mm256_add_epi32(ii, one), _mm256_add_epi32(jj, one), _mm256_add_epi32(kk, one),
+                          x3, y3, z3);
+
+    __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(n0, n1), n2), n3);
+    return _mm256_mul_ps(_mm256_set1_ps(32.0f), sum);
+}
+
+AVX2 static inline __m256 corner4_8(const unsigned char* p, __m256i ii, __m256i jj, __m256i kk, __m256i ll,
+                                    __m256 x, __m256 y, __m256 z, __m256 w) {
+    __m256 t = _mm256_set1_ps(0.6f);
+    t = _mm256_sub_ps(t, _mm256_mul_ps(x, x));
+    t = _mm256_sub_ps(t, _mm256_mul_ps(y, y));
+    t = _mm256_sub_ps(t, _mm256_mul_ps(z, z));
+    t = _mm256_sub_ps(t, _mm256_mul_ps(w, w));
+    __m256 live;
+    __m256 t4 = falloff8(t, &live);
+    __m256i h = perm8(p, _mm256_add_epi32(kk, perm8(p, ll)));
+    h = perm8(p, _mm256_add_epi32(ii, perm8(p, _mm256_add_epi32(jj, h))));
+    return _mm256_and_ps(live, _mm256_mul_ps(t4, grad4_8(h, x, y, z, w)));
+}
+
+// rank counts of snoise4_ctx, a lane of a is incremented where a > b and
+// b where it isn't
+AVX2 static inline void rank8(__m256 a, __m256 b, __m256i* ra, __m256i* rb) {
+    __m256i gt = _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GT_OQ));
+    *ra = _mm256_sub_epi32(*ra, gt);
+    *rb = _mm256_add_epi32(*rb, _mm256_add_epi32(gt, _mm256_set1_epi32(1)));
+}
+
+// 1 where rank >= n
+AVX2 static inline __m256i step8(__m256i rank, int n) {
+    return _mm256_and_si256(_mm256_cmpgt_epi32(rank, _mm256_set1_epi32(n - 1)), _mm256_set1_epi32(1));
+}
+
+AVX2 static __m256 simplex4_8(const unsigned char* p, __m256 x, __m256 y, __m256 z, __m256 w) {
+    __m256i mask = _mm256_set1_epi32(0xff);
+    __m256i one = _mm256_set1_epi32(1);
+    __m256 onef = _mm256_set1_ps(1.0f);
+
+    __m256 s = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(x, y), z), w), _mm256_set1_ps(F4));
+    __m256i i = floor8(_mm256_add_ps(x, s));
+    __m256i j = floor8(_mm256_add_ps(y, s));
+    __m256i k = floor8(_mm256_add_ps(z, s));
+    __m256i l = floor8(_mm256_add_ps(w, s));
+    __m256i ijkl = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(i, j), k), l);
+    __m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(ijkl), _mm256_set1_ps(G4));
+    __m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(_mm256_cvtepi32_ps(i), t));
+    __m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(_mm256_cvtepi32_ps(j), t));
+    __m256 z0 = _mm256_sub_ps(z, _mm256_sub_ps(_mm256_cvtepi32_ps(k), t));
+    __m256 w0 = _mm256_sub_ps(w, _mm256_sub_ps(_mm256_cvtepi32_ps(l), t));
+
+    __m256i rx = _mm256_setzero_si256();
+    __m256i ry = _mm256_setzero_si256();
+    __m256i rz = _mm256_setzero_si256();
+    __m256i rw = _mm256_setzero_si256();
+    rank8(x0, y0, &rx, &ry);
+    rank8(x0, z0, &rx, &rz);
+    rank8(x0, w0, &rx, &rw);
+    rank8(y0, z0, &ry, &rz);
+    rank8(y0, w0, &ry, &rw);
+    rank8(z0, w0, &rz, &rw);
+
+    __m256i ii = _mm256_and_si256(i, mask);
+    __m256i jj = _mm256_and_si256(j, mask);
+    __m256i kk = _mm256_and_si256(k, mask);
+    __m256i ll = _mm256_and_si256(l, mask);
+
+    __m256 sum = corner4_8(p, ii, jj, kk, ll, x0, y0, z0, w0);
+    for (int c = 1; c <= 3; c++) {
+        __m256i ic = step8(rx, 4 - c);
+        __m256i jc = step8(ry, 4 - c);
+        __m256i kc = step8(rz, 4 - c);
+        __m256i lc = step8(rw, 4 - c);
+        __m256 g = _mm256_set1_ps(c * G4);
+        __m256 xc = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_cvtepi32_ps(ic)), g);
+        __m256 yc = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_cvtepi32_ps(jc)), g);
+        __m256 zc = _mm256_add_ps(_mm256_sub_ps(z0, _mm256_cvtepi32_ps(kc)), g);
+        __m256 wc = _mm256_add_ps(_mm256_sub_ps(w0, _mm256_cvtepi32_ps(lc)), g);
+        sum = _mm256_add_ps(sum, corner4_8(p, _mm256_add_epi32(ii, ic), _mm256_add_epi32(jj, jc),
+                                           _mm256_add_epi32(kk, kc), _mm256_add_epi32(ll, lc), xc, yc, zc, wc));
+    }
+    __m256 g4 = _mm256_set1_ps(4.0f * G4);
+    __m256 x4 = _mm256_add_ps(_mm256_sub_ps(x0, onef), g4);
+    __m256 y4 = _mm256_add_ps(_mm256_sub_ps(y0, onef), g4);
+    __m256 z4 = _mm256_add_ps(_mm256_sub_ps(z0, onef), g4);
+    __m256 w4 = _mm256_add_ps(_mm256_sub_ps(w0, onef), g4);
+    sum = _mm256_add_ps(sum, corner4_8(p, _mm256_add_epi32(ii, one), _mm256_add_epi32(jj, one),
+                                       _mm256_add_epi32(kk, one), _mm256_add_epi32(ll, one), x4, y4, z4, w4));
+
+    return _mm256_mul_ps(_mm256_set1_ps(27.0f), sum);
+}
+
+AVX2 static int simplex2_batch_avx2(const unsigned char* p, const float* x, const float* y, float* out, int n,
+                                    const rs_octave_plan* plan) {
+    int i = 0;
+    __m256 m = _mm256_set1_ps(plan->max_value);
+    for (; i + 8 <= n; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 total = _mm256_setzero_ps();
+        for (int o = 0; o < plan->count; o++) {
+            __m256 f = _mm256_set1_ps(plan->frequency[o]);
+            __m256 v = simplex2_8(p, _mm256_mul_ps(vx, f), _mm256_mul_ps(vy, f));
+            total = _mm256_add_ps(total, _mm256_mul_ps(v, _mm256_set1_ps(plan->amplitude[o])));
+        }
+        _mm256_storeu_ps(out + i, _mm256_div_ps(total, m));
+    }
+    return i;
+}
+
+AVX2 static int simplex3_batch_avx2(const unsigned char* p, const float* x, const float* y, const float* z,
+                                    float* out, int n, const rs_octave_plan* plan) {
+    int i = 0;
+    __m256 m = _mm256_set1_ps(plan->max_value);
+    for (; i + 8 <= n; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 vz = _mm256_loadu_ps(z + i);
+        __m256 total = _mm256_setzero_ps();
+        for (int o = 0; o < plan->count; o++) {
+            __m256 f = _mm256_set1_ps(plan->frequency[o]);
+            __m256 v = simplex3_8(p, _mm256_mul_ps(vx, f), _mm256_mul_ps(vy, f), _mm256_mul_ps(vz, f));
+            total = _mm256_add_ps(total, _mm256_mul_ps(v, _mm256_set1_ps(plan->amplitude[o])));
+        }
+        _mm256_storeu_ps(out + i, _mm256_div_ps(total, m));
+    }
+    return i;
+}
+
+AVX2 static int simplex4_batch_avx2(const unsigned char* p, const float* x, const float* y, const float* z,
+                                    const float* w, float* out, int n, const rs_octave_plan* plan) {
+    int i = 0;
+    __m256 m = _mm256_set1_ps(plan->max_value);
+    for (; i + 8 <= n; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 vz = _mm256_loadu_ps(z + i);
+        __m256 vw = _mm256_loadu_ps(w + i);
+        __m256 total = _mm256_setzero_ps();
+        for (int o = 0; o < plan->count; o++) {
+            __m256 f = _mm256_set1_ps(plan->frequency[o]);
+            __m256 v = simplex4_8(p, _mm256_mul_ps(vx, f), _mm256_mul_ps(vy, f), _mm256_mul_ps(vz, f),
+                                  _mm256_mul_ps(vw, f));
+            total = _mm256_add_ps(total, _mm256_mul_ps(v, _mm256_set1_ps(plan->amplitude[o])));
+        }
+        _mm256_storeu_ps(out + i, _mm256_div_ps(total, m));
+    }
+    return i;
+}
+
+//---------------------------------------------------------------------
+// dispatch
+
+static int has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+void csnoise2_filtered_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, int n,
+                                 float footprint, int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    rs_octave_plan plan;
+    if (has_avx2() && rs_make_octave_plan(&plan, footprint, octaves, persistence, lacunarity)) {
+        i = simplex2_batch_avx2(ctx->perm, x, y, out, n, &plan);
+    }
+    for (; i < n; i++) {
+        out[i] = csnoise2_filtered_ctx(ctx, x[i], y[i], footprint, octaves, persistence, lacunarity);
+    }
+}
+
+// a plan with a footprint of 0 holds every octave with the amplitudes of
+// the unfiltered loop
+void csnoise2_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, int n,
+                        int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    rs_octave_plan plan;
+    if (has_avx2() && rs_make_octave_plan(&plan, 0, octaves, persistence, lacunarity)) {
+        i = simplex2_batch_avx2(ctx->perm, x, y, out, n, &plan);
+    }
+    for (; i < n; i++) {
+        out[i] = csnoise2_ctx(ctx, x[i], y[i], octaves, persistence, lacunarity);
+    }
+}
+
+void csnoise3_batch_ctx(const rs_noise* ctx, const float* x, const float* y, const float* z, float* out, int n,
+                        int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    rs_octave_plan plan;
+    if (has_avx2() && rs_make_octave_plan(&plan, 0, octaves, persistence, lacunarity)) {
+        i = simplex3_batch_avx2(ctx->perm, x, y, z, out, n, &plan);
+    }
+    for (; i < n; i++) {
+        out[i] = csnoise3_ctx(ctx, x[i], y[i], z[i], octaves, persistence, lacunarity);
+    }
+}
+
+void csnoise4_batch_ctx(const rs_noise* ctx, const float* x, const float* y, const float* z, const float* w,
+                        float* out, int n, int octaves, float persistence, float lacunarity) {
+    int i = 0;
+    rs_octave_plan plan;
+    if (has_avx2() && rs_make_octave_plan(&plan, 0, octaves, persistence, lacunarity)) {
+        i = simplex4_batch_avx2(ctx->perm, x, y, z, w, out, n, &plan);
+    }
+    for (; i < n; i++) {
+        out[i] = csnoise4_ctx(ctx, x[i], y[i], z[i], w[i], octaves, persistence, lacunarity);
+    }
+}
+
+void snoise2_batch_ctx(const rs_noise* ctx, const float* x, const float* y, float* out, int n) {
+    // a single octave of csnoise2 is snoise2 divided by an amplitude sum of 1
+    csnoise2_batch_ctx(ctx, x, y, out, n, 1, 1.0f, 1.0f);
+}
+
+void snoise3_batch_ctx(const rs_noise* ctx, const float* x, const float* y, const float* z, float* out, int n) {
+    csnoise3_batch_ctx(ctx, x, y, z, out, n, 1, 1.0f, 1.0f);
+}
+
+void snoise4_batch_ctx(const rs_noise* ctx, const float* x, const float* y, const float* z, const float* w,
+                       float* out, int n) {
+    csnoise4_batch_ctx(ctx, x, y, z, w, out, n, 1, 1.0f, 1.0f);
+}
+
+void snoise2_batch(const float* x, const float* y, float* out, int n) {
+    snoise2_batch_ctx(rs_default_noise(), x, y, out, n);
+}
+
+void snoise3_batch(const float* x, const float* y, const float* z, float* out, int n) {
+    snoise3_batch_ctx(rs_default_noise(), x, y, z, out, n);
+}
+
+void snoise4_batch(const float* x, const float* y, const float* z, const float* w, float* out, int n) {
+    snoise4_batch_ctx(rs_default_noise(), x, y, z, w, out, n);
+}
+
+void csnoise2_batch(const float* x, const float* y, float* out, int n, int octaves, float persistence, float lacunarity) {
+    csnoise2_batch_ctx(rs_default_noise(), x, y, out, n, octaves, persistence, lacunarity);
+}
+
+void csnoise3_batch(const float* x, const float* y, const float* z, float* out, int n,
+                    int octaves, float persistence, float lacunarity) {
+    csnoise3_batch_ctx(rs_default_noise(), x, y, z, out, n, octaves, persistence, lacunarity);
+}
+
+void csnoise4_batch(const float* x, const float* y, const float* z, const float* w, float* out, int n,
+                    int octaves, float persistence, float lacunarity) {
+    csnoise4_batch_ctx(rs_default_noise(), x, y, z, w, out, n, octaves, persistence, lacunarity);
+}
@@ -0,0 +1,390 @@
+#include <stdlib.h>
+#include <string.h>
+#include "rs_sparse.h"
+#include "rs_rand.h"
+#include "rs_pool.h"
+
+#define MIN_BUCKETS (64)
+#define MIN_TILE_SIZE (4)
+// tiles per task when classifying
+#define SPARSE_GRAIN (16)
+
+static u32 tile_cells(rs_sparse_grid* s) {
+    return s->tile_size * s->tile_size;
+}
+
+static size_t tile_bytes(rs_sparse_grid* s) {
+    return sizeof(rs_sparse_tile) + (size_t)tile_cells(s) * sizeof(float);
+}
+
+static rs_sparse_tile* alloc_tile(rs_sparse_grid* s) {
+    rs_sparse_tile* t = malloc(tile_bytes(s));
+    t->hash = 0;
+    t->refs = 1;
+    t->shared = 0;
+    t->next = NULL;
+    return t;
+}
+
+// cells of tile (tx, ty) inside the grid
+static void tile_extent(rs_sparse_grid* s, u32 tx, u32 ty, u32* w, u32* h) {
+    u32 x0 = tx << s->tile_shift;
+    u32 y0 = ty << s->tile_shift;
+    *w = s->width - x0 < s->tile_size ? s->width - x0 : s->tile_size;
+    *h = s->height - y0 < s->tile_size ? s->height - y0 : s->tile_size;
+}
+
+static int bits_equal(float a, float b) {
+    return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+static int tile_uniform(rs_sparse_grid* s, rs_sparse_tile* t, u32 w, u32 h) {
+    u32 first;
+    memcpy(&first, t->data, sizeof(first));
+    for (u32 y = 0; y < h; y++) {
+        const float* row = t->data + (y << s->tile_shift);
+        for (u32 x = 0; x < w; x++) {
+            u32 b;
+            memcpy(&b, row + x, sizeof(b));
+            if (b != first) return 0;
+        }
+    }
+    return 1;
+}
+
+// four independent lanes so the multiplies overlap
+static u64 tile_hash(const float* data, u32 cells) {
+    u64 h[4] = { 1, 2, 3, 4 };
+    for (u32 i = 0; i + 8 <= cells; i += 8) {
+        for (int k = 0; k < 4; k++) {
+            u64 v;
+            memcpy(&v, data + i + 2 * k, sizeof(v));
+            h[k] = (h[k] ^ v) * RS_RAND_GOLDEN;
+            h[k] ^= h[k] >> 29;
+        }
+    }
+    return rs_hash64(h[0] ^ rs_hash64(h[1] ^ rs_hash64(h[2] ^ rs_hash64(h[3]))));
+}
+
+//
+// dedup table
+//
+
+static u32 bucket_of(rs_sparse_grid* s, u64 hash) {
+    return (u32)rs_hash64(hash) & (s->num_buckets - 1);
+}
+
+static void rehash(rs_sparse_grid* s, u32 num_buckets) {
+    rs_sparse_tile** old = s->buckets;
+    u32 old_n = s->num_buckets;
+    s->buckets = calloc(num_buckets, sizeof(rs_sparse_tile*));
+    s->num_buckets = num_buckets;
+    for (u32 i = 0; i < old_n; i++) {
+        rs_sparse_tile* t = old[i];
+        while (t != NULL) {
+            rs_sparse_tile* next = t->next;
+            u32 b = bucket_of(s, t->hash);
+            t->next = s->buckets[b];
+            s->buckets[b] = t;
+            t = next;
+        }
+    }
+    free(old);
+}
+
+static void unlink_shared(rs_sparse_grid* s, rs_sparse_tile* t) {
+    rs_sparse_tile** link = &s->buckets[bucket_of(s, t->hash)];
+    while (*link != t) {
+        link = &(*link)->next;
+    }
+    *link = t->next;
+    t->next = NULL;
+    t->shared = 0;
+    s->num_shared--;
+}
+
+// hands a hashed private tile to the table, or swaps it for an equal
+// tile already there
+static void share(rs_sparse_grid* s, rs_sparse_slot* slot) {
+    rs_sparse_tile* t = slot->tile;
+    size_t bytes = (size_t)tile_cells(s) * sizeof(float);
+    u32 b = bucket_of(s, t->hash);
+    for (rs_sparse_tile* k = s->buckets[b]; k != NULL; k = k->next) {
+        if (k->hash == t->hash && memcmp(k->data, t->data, bytes) == 0) {
+            k->refs++;
+            slot->tile = k;
+            free(t);
+            return;
+        }
+    }
+
+    if (s->num_shared >= s->num_buckets) {
+        rehash(s, s->num_buckets * 2);
+        b = bucket_of(s, t->hash);
+    }
+    t->shared = 1;
+    t->next = s->buckets[b];
+    s->buckets[b] = t;
+    s->num_shared++;
+    s->num_tiles++;
+}
+
+static void release(rs_sparse_grid* s, rs_sparse_slot* slot) {
+    rs_sparse_tile* t = slot->tile;
+    if (t == NULL) return;
+    slot->tile = NULL;
+    if (t->shared) {
+        if (--t->refs > 0) return;
+        unlink_shared(s, t);
+    }
+    free(t);
+    s->num_tiles--;
+}
+
+//
+// classification of private tiles, in parallel before they're shared
+//
+
+typedef struct {
+    rs_sparse_grid* s;
+    rs_grid* g;
+    u32* slots;               // slot indices to classify
+} sparse_job;
+
+static void classify(rs_sparse_grid* s, u32 i) {
+    rs_sparse_slot* slot = &s->slots[i];
+    rs_sparse_tile* t = slot->tile;
+    u32 w, h;
+    tile_extent(s, i % s->tiles_x, i / s->tiles_x, &w, &h);
+    if (tile_uniform(s, t, w, h)) {
+        slot->value = t->data[0];
+        slot->tile = NULL;
+        free(t);
+        return;
+    }
+    t->hash = tile_hash(t->data, tile_cells(s));
+}
+
+static void classify_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    sparse_job* job = ctx;
+    for (u32 k = begin; k < end; k++) {
+        classify(job->s, job->slots[k]);
+    }
+}
+
+// classifies the listed private tiles, then shares the ones left in order
+static void collapse(rs_sparse_grid* s, u32* slots, u32 count) {
+    sparse_job job = { .s = s, .slots = slots };
+    rs_pool_parallel_for(rs_default_pool(), count, SPARSE_GRAIN, classify_chunks, &job);
+    for (u32 k = 0; k < count; k++) {
+        if (s->slots[slots[k]].tile != NULL) {
+            share(s, &s->slots[slots[k]]);
+        }
+    }
+}
+
+//
+// rs_sparse_grid functions
+//
+
+rs_sparse_grid* rs_make_sparse_grid(u32 width, u32 height, u32 tile_size) {
+    rs_sparse_grid* s = calloc(1, sizeof(rs_sparse_grid));
+    s->width = width;
+    s->height = height;
+    s->tile_size = MIN_TILE_SIZE;
+    s->tile_shift = 2;
+    while (s->tile_size < tile_size) {
+        s->tile_size <<= 1;
+        s->tile_shift++;
+    }
+    s->tiles_x = (width + s->tile_size - 1) >> s->tile_shift;
+    s->tiles_y = (height + s->tile_size - 1) >> s->tile_shift;
+    s->slots = calloc((size_t)s->tiles_x * s->tiles_y + 1, sizeof(rs_sparse_slot));
+    s->num_buckets = MIN_BUCKETS;
+    s->buckets = calloc(s->num_buckets, sizeof(rs_sparse_tile*));
+    return s;
+}
+
+void rs_free_sparse_grid(rs_sparse_grid* s) {
+    if (s == NULL) return;
+    rs_sparse_fill(s, 0);
+    free(s->buckets);
+    free(s->slots);
+    free(s);
+}
+
+static void copy_in_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    sparse_job* job = ctx;
+    rs_sparse_grid* s = job->s;
+    for (u32 i = begin; i < end; i++) {
+        u32 tx = i % s->tiles_x;
+        u32 ty = i / s->tiles_x;
+        u32 w, h;
+        tile_extent(s, tx, ty, &w, &h);
+        rs_sparse_tile* t = alloc_tile(s);
+        if (w < s->tile_size || h < s->tile_size) {
+            memset(t->data, 0, (size_t)tile_cells(s) * sizeof(float));
+        }
+        const float* src = job->g->data + (tx << s->tile_shift) + (size_t)(ty << s->tile_shift) * s->width;
+        for (u32 y = 0; y < h; y++) {
+            memcpy(t->data + (y << s->tile_shift), src + (size_t)y * s->width, w * sizeof(float));
+        }
+        s->slots[i].tile = t;
+        classify(s, i);
+    }
+}
+
+rs_sparse_grid* rs_sparse_from_grid(rs_grid* g, u32 tile_size) {
+    rs_sparse_grid* s = rs_make_sparse_grid(g->width, g->height, tile_size);
+    u32 count = s->tiles_x * s->tiles_y;
+    sparse_job job = { .s = s, .g = g };
+    rs_pool_parallel_for(rs_default_pool(), count, SPARSE_GRAIN, copy_in_chunks, &job);
+    for (u32 i = 0; i < count; i++) {
+        if (s->slots[i].tile != NULL) {
+            share(s, &s->slots[i]);
+        }
+    }
+    return s;
+}
+
+float rs_sparse_get(rs_sparse_grid* s, u32 x, u32 y) {
+    if (x >= s->width) return 0;
+    if (y >= s->height) return 0;
+    rs_sparse_slot* slot = &s->slots[(x >> s->tile_shift) + (y >> s->tile_shift) * s->tiles_x];
+    if (slot->tile == NULL) return slot->value;
+    u32 mask = s->tile_size - 1;
+    return slot->tile->data[(x & mask) + ((y & mask) << s->tile_shift)];
+}
+
+void rs_sparse_set(rs_sparse_grid* s, u32 x, u32 y, float value) {
+    if (x >= s->width) return;
+    if (y >= s->height) return;
+    u32 tx = x >> s->tile_shift;
+    u32 ty = y >> s->tile_shift;
+    rs_sparse_slot* slot = &s->slots[tx + ty * s->tiles_x];
+    rs_sparse_tile* t = slot->tile;
+
+    if (t == NULL) {
+        if (bits_equal(slot->value, value)) return;
+        // expand the uniform tile
+        u32 w, h;
+        tile_extent(s, tx, ty, &w, &h);
+        t = alloc_tile(s);
+        memset(t->data, 0, (size_t)tile_cells(s) * sizeof(float));
+        for (u32 j = 0; j < h; j++) {
+            float* row = t->data + (j << s->tile_shift);
+            for (u32 i = 0; i < w; i++) {
+                row[i] = slot->value;
+            }
+        }
+        slot->tile = t;
+        s->num_tiles++;
+    } else if (t->shared) {
+        if (t->refs == 1) {
+            unlink_shared(s, t);
+        } else {
+            // copy on write
+            rs_sparse_tile* copy = alloc_tile(s);
+            memcpy(copy->data, t->data, (size_t)tile_cells(s) * sizeof(float));
+            t->refs--;
+            slot->tile = t = copy;
+            s->num_tiles++;
+        }
+    }
+
+    u32 mask = s->tile_size - 1;
+    t->data[(x & mask) + ((y & mask) << s->tile_shift)] = value;
+}
+
+void rs_sparse_fill(rs_sparse_grid* s, float value) {
+    u32 count = s->tiles_x * s->tiles_y;
+    for (u32 i = 0; i < count; i++) {
+        release(s, &s->slots[i]);
+        s->slots[i].value = value;
+    }
+}
+
+void rs_sparse_compact(rs_sparse_grid* s) {
+    u32 count = s->tiles_x * s->tiles_y;
+    u32* dirty = malloc((count > 0 ? count : 1) * sizeof(u32));
+    u32 num_dirty = 0;
+    for (u32 i = 0; i < count; i++) {
+        rs_sparse_tile* t = s->slots[i].tile;
+        if (t != NULL && !t->shared) {
+            dirty[num_dirty++] = i;
+        }
+    }
+    // share() counts them again as they go in the table
+    s->num_tiles -= num_dirty;
+    collapse(s, dirty, num_dirty);
+    free(dirty);
+}
+
+void rs_sparse_read(rs_sparse_grid* s, int x0, int y0, u32 w, u32 h, float* out, u32 out_stride) {
+    u32 mask = s->tile_size - 1;
+    for (u32 j = 0; j < h; j++) {
+        float* row = out + (size_t)j * out_stride;
+        long y = (long)y0 + j;
+        if (y < 0 || y >= s->height) {
+            memset(row, 0, w * sizeof(float));
+            continue;
+        }
+        const rs_sparse_slot* slots = &s->slots[(y >> s->tile_shift) * s->tiles_x];
+        u32 ly = (u32)y & mask;
+
+        u32 i = 0;
+        while (i < w) {
+            long x = (long)x0 + i;
+            if (x < 0) {
+                u32 n = (u32)(-x) < w - i ? (u32)(-x) : w - i;
+                memset(row + i, 0, n * sizeof(float));
+                i += n;
+                continue;
+            }
+            if (x >= s->width) {
+                memset(row + i, 0, (w - i) * sizeof(float));
+                break;
+            }
+            u32 lx = (u32)x & mask;
+            u32 n = s->tile_size - lx;
+            if (n > w - i) n = w - i;
+            if (n > s->width - (u32)x) n = s->width - (u32)x;
+
+            const rs_sparse_slot* slot = &slots[x >> s->tile_shift];
+            if (slot->tile == NULL) {
+                for (u32 k = 0; k < n; k++) {
+                    row[i + k] = slot->value;
+                }
+            } else {
+                memcpy(row + i, slot->tile->data + lx + (ly << s->tile_shift), n * sizeof(float));
+            }
+            i += n;
+        }
+    }
+}
+
+static void copy_out_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    sparse_job* job = ctx;
+    rs_sparse_grid* s = job->s;
+    u32 y0 = begin << s->tile_shift;
+    u32 y1 = end << s->tile_shift;
+    if (y1 > s->height) y1 = s->height;
+    rs_sparse_read(s, 0, (int)y0, s->width, y1 - y0, job->g->data + (size_t)y0 * s->width, s->width);
+}
+
+rs_grid* rs_sparse_to_grid(rs_sparse_grid* s) {
+    rs_grid* g = rs_make_grid(s->width, s->height);
+    sparse_job job = { .s = s, .g = g };
+    rs_pool_parallel_for(rs_default_pool(), s->tiles_y, 1, copy_out_chunks, &job);
+    return g;
+}
+
+size_t rs_sparse_bytes(rs_sparse_grid* s) {
+    return sizeof(rs_sparse_grid)
+        + (size_t)s->tiles_x * s->tiles_y * sizeof(rs_sparse_slot)
+        + (size_t)s->num_buckets * sizeof(rs_sparse_tile*)
+        + (size_t)s->num_tiles * tile_bytes(s);
+}
@@ -0,0 +1,66 @@
+#ifndef RS_SPARSE_H
+#define RS_SPARSE_H
+
+#include <stddef.h>
+#include "rs.h"
+
+#define RS_SPARSE_TILE_SIZE (64)
+
+//
+// grid stored as square tiles where a tile whose cells all hold the same
+// value is just that value, and tiles with identical contents are stored
+// once. flat ocean and clamped plateaus cost a float per tile instead of
+// a tile of floats. shared tiles are read only, rs_sparse_set copies one
+// before writing to it, and rs_sparse_compact collapses and deduplicates
+// the tiles written since. cells are compared bit for bit.
+//
+
+typedef struct rs_sparse_tile {
+    u64 hash;
+    u32 refs;                 // slots using this tile
+    int shared;               // in the dedup table, never written
+    struct rs_sparse_tile* next;   // hash chain
+    float data[];             // tile_size * tile_size, edge tiles padded with 0
+} rs_sparse_tile;
+
+typedef struct {
+    rs_sparse_tile* tile;     // NULL for a uniform tile
+    float value;              // every cell of a uniform tile
+} rs_sparse_slot;
+
+typedef struct {
+    u32 width;
+    u32 height;
+    u32 tile_size;            // a power of two
+    u32 tile_shift;
+    u32 tiles_x;
+    u32 tiles_y;
+    rs_sparse_slot* slots;
+    u32 num_buckets;
+    rs_sparse_tile** buckets;
+    u32 num_tiles;            // distinct tiles allocated
+    u32 num_shared;           // of which in the dedup table
+} rs_sparse_grid;
+
+// every cell 0. tile_size is rounded up to a power of two
+rs_sparse_grid* rs_make_sparse_grid(u32 width, u32 height, u32 tile_size);
+rs_sparse_grid* rs_sparse_from_grid(rs_grid* g, u32 tile_size);
+void rs_free_sparse_grid(rs_sparse_grid* s);
+
+// same contract as rs_grid_get and rs_grid_set
+float rs_sparse_get(rs_sparse_grid* s, u32 x, u32 y);
+void rs_sparse_set(rs_sparse_grid* s, u32 x, u32 y, float value);
+void rs_sparse_fill(rs_sparse_grid* s, float value);
+
+// copies the w x h cells at (x0, y0) to out, with out_stride floats
+// between rows. cells outside the grid read 0
+void rs_sparse_read(rs_sparse_grid* s, int x0, int y0, u32 w, u32 h, float* out, u32 out_stride);
+rs_grid* rs_sparse_to_grid(rs_sparse_grid* s);
+
+// collapses and shares the tiles written since the last compaction
+void rs_sparse_compact(rs_sparse_grid* s);
+
+// memory in use, against width * height * sizeof(float) dense
+size_t rs_sparse_bytes(rs_sparse_grid* s);
+
+#endif
@@ -0,0 +1,120 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "rs_spatial.h"
+
+rs_spatial* rs_make_spatial(float cell_size) {
+    rs_spatial* s = calloc(1, sizeof(rs_spatial));
+    s->cell_size = cell_size;
+    return s;
+}
+
+void rs_free_spatial(rs_spatial* s) {
+    free(s->cell_start);
+    free(s->indices);
+    free(s);
+}
+
+static u32 cell_of(rs_spatial* s, float inv_size, Vector2 pos) {
+    u32 cx = (u32)((pos.x - s->min_x) * inv_size);
+    u32 cy = (u32)((pos.y - s->min_y) * inv_size);
+    if (cx >= s->cols) cx = s->cols - 1;
+    if (cy >= s->rows) cy = s->rows - 1;
+    return cx + cy * s->cols;
+}
+
+void rs_spatial_build(rs_spatial* s, particle* p, u32 count) {
+    float min_x = FLT_MAX, min_y = FLT_MAX;
+    float max_x = -FLT_MAX, max_y = -FLT_MAX;
+    for (u32 i = 0; i < count; i++) {
+        Vector2 pos = p[i].position;
+        if (pos.x < min_x) min_x = pos.x;
+        if (pos.x > max_x) max_x = pos.x;
+        if (pos.y < min_y) min_y = pos.y;
+        if (pos.y > max_y) max_y = pos.y;
+    }
+    if (count == 0) {
+        min_x = min_y = max_x = max_y = 0;
+    }
+
+    float size = s->cell_size;
+    float extent = fmaxf(max_x - min_x, max_y - min_y);
+    if (extent / size >= RS_SPATIAL_MAX_CELLS) {
+        size = extent / (RS_SPATIAL_MAX_CELLS - 1);
+    }
+    float inv_size = 1.0f / size;
+
+    u32 cols = (u32)((max_x - min_x) * inv_size) + 1;
+    u32 rows = (u32)((max_y - min_y) * inv_size) + 1;
+    if (cols * rows + 1 > s->cell_capacity) {
+        free(s->cell_start);
+        s->cell_capacity = cols * rows + 1;
+        s->cell_start = malloc(s->cell_capacity * sizeof(u32));
+    }
+    if (count > s->capacity) {
+        free(s->indices);
+        s->indices = malloc(count * sizeof(u32));
+        s->capacity = count;
+    }
+
+    s->min_x = min_x;
+    s->min_y = min_y;
+    s->cols = cols;
+    s->rows = rows;
+    s->count = count;
+    s->bucket_size = size;
+
+    // counting sort: histogram, exclusive prefix sum, scatter
+    u32 num_cells = cols * rows;
+    memset(s->cell_start, 0, (num_cells + 1) * sizeof(u32));
+    for (u32 i = 0; i < count; i++) {
+        s->cell_start[cell_of(s, inv_size, p[i].position) + 1]++;
+    }
+    for (u32 c = 0; c < num_cells; c++) {
+        s->cell_start[c + 1] += s->cell_start[c];
+    }
+    for (u32 i = 0; i < count; i++) {
+        u32 c = cell_of(s, inv_size, p[i].position);
+        s->indices[s->cell_start[c]++] = i;
+    }
+    // the scatter advanced every start to the next cell's start, shift back
+    for (u32 c = num_cells; c > 0; c--) {
+        s->cell_start[c] = s->cell_start[c - 1];
+    }
+    s->cell_start[0] = 0;
+}
+
+u32 rs_spatial_query(rs_spatial* s, particle* p, Vector2 center, float radius, u32* out) {
+    if (s->count == 0) return 0;
+
+    float inv_size = 1.0f / s->bucket_size;
+    float lo_x = floorf((center.x - radius - s->min_x) * inv_size);
+    float lo_y = floorf((center.y - radius - s->min_y) * inv_size);
+    float hi_x = floorf((center.x + radius - s->min_x) * inv_size);
+    float hi_y = floorf((center.y + radius - s->min_y) * inv_size);
+    if (hi_x < 0 || hi_y < 0 || lo_x >= s->cols || lo_y >= s->rows) return 0;
+
+    u32 x0 = lo_x < 0 ? 0 : (u32)lo_x;
+    u32 y0 = lo_y < 0 ? 0 : (u32)lo_y;
+    u32 x1 = hi_x >= s->cols ? s->cols - 1 : (u32)hi_x;
+    u32 y1 = hi_y >= s->rows ? s->rows - 1 : (u32)hi_y;
+
+    float r2 = radius * radius;
+    u32 n = 0;
+    for (u32 cy = y0; cy <= y1; cy++) {
+        for (u32 cx = x0; cx <= x1; cx++) {
+            u32 c = cx + cy * s->cols;
+            for (u32 k = s->cell_start[c]; k < s->cell_start[c + 1]; k++) {
+                u32 i = s->indices[k];
+                float dx = p[i].position.x - center.x;
+                float dy = p[i].position.y - center.y;
+                if (dx * dx + dy * dy <= r2) {
+                    if (out != NULL) out[n] = i;
+                    n++;
+                }
+            }
+        }
+    }
+    return n;
+}
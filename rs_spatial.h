@@ -0,0 +1,35 @@
+#ifndef RS_SPATIAL_H
+#define RS_SPATIAL_H
+
+#include "rs.h"
+#include "rs_particles.h"
+
+// axis cell count limit, cells grow past cell_size for very spread out scenes
+#define RS_SPATIAL_MAX_CELLS (1024)
+
+//
+// uniform grid over particle positions, built with a counting sort so the
+// particles of one cell are contiguous in indices. positions are read at
+// build time, rebuild after the particles move or the array changes.
+//
+typedef struct {
+    float cell_size;
+    float bucket_size;
+    float min_x, min_y;
+    u32 cols, rows;
+    u32 count;
+    u32 capacity;
+    u32 cell_capacity;
+    u32* cell_start;
+    u32* indices;
+} rs_spatial;
+
+rs_spatial* rs_make_spatial(float cell_size);
+void rs_free_spatial(rs_spatial* s);
+void rs_spatial_build(rs_spatial* s, particle* p, u32 count);
+
+// indices of the particles within radius of center, written to out when it
+// isn't NULL (it needs room for every match). returns the number of matches.
+u32 rs_spatial_query(rs_spatial* s, particle* p, Vector2 center, float radius, u32* out);
+
+#endif
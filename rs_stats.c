@@ -0,0 +1,361 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <immintrin.h>
+#include "rs_stats.h"
+#include "rs_pool.h"
+
+#define AVX2 __attribute__((target("avx2")))
+
+// cells per task, the partial results live in an array indexed by chunk
+#define STATS_GRAIN (1 << 16)
+#define PERCENTILE_BINS (4096)
+
+static int has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static u32 num_chunks(u32 size) {
+    return (size + STATS_GRAIN - 1) / STATS_GRAIN;
+}
+
+//
+// span kernels
+//
+
+AVX2 static u32 minmax_avx2(const float* v, u32 n, float* lo, float* hi) {
+    __m256 vmin = _mm256_set1_ps(FLT_MAX);
+    __m256 vmax = _mm256_set1_ps(-FLT_MAX);
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) {
+        // min/max return the second operand for NaN, skipping it
+        __m256 x = _mm256_loadu_ps(v + i);
+        vmin = _mm256_min_ps(x, vmin);
+        vmax = _mm256_max_ps(x, vmax);
+    }
+    float mins[8], maxs[8];
+    _mm256_storeu_ps(mins, vmin);
+    _mm256_storeu_ps(maxs, vmax);
+    for (int k = 0; k < 8; k++) {
+        if (mins[k] < *lo) *lo = mins[k];
+        if (maxs[k] > *hi) *hi = maxs[k];
+    }
+    return i;
+}
+
+rs_range rs_range_merge(rs_range r, const float* v, u32 n) {
+    u32 i = 0;
+    if (has_avx2()) {
+        i = minmax_avx2(v, n, &r.min, &r.max);
+    }
+    for (; i < n; i++) {
+        if (v[i] < r.min) r.min = v[i];
+        if (v[i] > r.max) r.max = v[i];
+    }
+    return r;
+}
+
+rs_range rs_span_minmax(const float* v, u32 n) {
+    rs_range r = { FLT_MAX, -FLT_MAX };
+    return rs_range_merge(r, v, n);
+}
+
+AVX2 static u32 remap_avx2(float* v, u32 n, float in_min, float in_range, float out_min, float out_range) {
+    __m256 a = _mm256_set1_ps(in_min);
+    __m256 b = _mm256_set1_ps(out_min);
+    __m256 s = _mm256_set1_ps(out_range);
+    __m256 d = _mm256_set1_ps(in_range);
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_sub_ps(_mm256_loadu_ps(v + i), a);
+        x = _mm256_div_ps(_mm256_mul_ps(x, s), d);
+        _mm256_storeu_ps(v + i, _mm256_add_ps(b, x));
+    }
+    return i;
+}
+
+void rs_span_remap(float* v, u32 n, float in_min, float in_max, float out_min, float out_max) {
+    // the swaps rs_remap() does per call
+    if (in_max < in_min) {
+        float t = in_max;
+        in_max = in_min;
+        in_min = t;
+    }
+    if (out_max < out_min) {
+        float t = out_max;
+        out_max = out_min;
+        out_min = t;
+    }
+    float in_range = in_max - in_min;
+    float out_range = out_max - out_min;
+
+    u32 i = 0;
+    if (has_avx2()) {
+        i = remap_avx2(v, n, in_min, in_range, out_min, out_range);
+    }
+    for (; i < n; i++) {
+        v[i] = out_min + (v[i] - in_min) * out_range / in_range;
+    }
+}
+
+AVX2 static u32 affine_avx2(float* v, u32 n, float scale, float offset) {
+    __m256 s = _mm256_set1_ps(scale);
+    __m256 o = _mm256_set1_ps(offset);
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(v + i, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(v + i), s), o));
+    }
+    return i;
+}
+
+static void span_affine(float* v, u32 n, float scale, float offset) {
+    u32 i = 0;
+    if (has_avx2()) {
+        i = affine_avx2(v, n, scale, offset);
+    }
+    for (; i < n; i++) {
+        v[i] = v[i] * scale + offset;
+    }
+}
+
+// count, mean and sum of squared deviations of a span, two passes while it
+// is in cache
+AVX2 static u32 sum_avx2(const float* v, u32 n, double* sum, u32* count) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256i cnt = _mm256_setzero_si256();
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(v + i);
+        __m256 ok = _mm256_cmp_ps(x, x, _CMP_ORD_Q);
+        x = _mm256_and_ps(x, ok);
+        acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm256_castps256_ps128(x)));
+        acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)));
+        cnt = _mm256_sub_epi32(cnt, _mm256_castps_si256(ok));
+    }
+    double sums[4];
+    _mm256_storeu_pd(sums, _mm256_add_pd(acc0, acc1));
+    *sum += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    u32 counts[8];
+    _mm256_storeu_si256((__m256i*)counts, cnt);
+    for (int k = 0; k < 8; k++) {
+        *count += counts[k];
+    }
+    return i;
+}
+
+AVX2 static u32 deviation_avx2(const float* v, u32 n, double mean, double* m2) {
+    __m256d m = _mm256_set1_pd(mean);
+    __m256d acc = _mm256_setzero_pd();
+    u32 i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_cvtps_pd(_mm_loadu_ps(v + i));
+        __m256d ok = _mm256_cmp_pd(x, x, _CMP_ORD_Q);
+        __m256d d = _mm256_and_pd(_mm256_sub_pd(x, m), ok);
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+    }
+    double sums[4];
+    _mm256_storeu_pd(sums, acc);
+    *m2 += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    return i;
+}
+
+typedef struct {
+    u32 count;
+    double mean;
+    double m2;
+    rs_range range;
+} span_moments;
+
+static span_moments moments(const float* v, u32 n) {
+    span_moments s = { 0, 0, 0, rs_span_minmax(v, n) };
+    int avx2 = has_avx2();
+
+    double sum = 0;
+    u32 i = avx2 ? sum_avx2(v, n, &sum, &s.count) : 0;
+    for (; i < n; i++) {
+        if (isnan(v[i])) continue;
+        sum += v[i];
+        s.count++;
+    }
+    if (s.count == 0) return s;
+    s.mean = sum / s.count;
+
+    i = avx2 ? deviation_avx2(v, n, s.mean, &s.m2) : 0;
+    for (; i < n; i++) {
+        if (isnan(v[i])) continue;
+        double d = v[i] - s.mean;
+        s.m2 += d * d;
+    }
+    return s;
+}
+
+//
+// grid reductions
+//
+
+typedef struct {
+    float* data;
+    u32 size;
+    span_moments* partial;
+    rs_range* ranges;
+    u32* bins;               // per worker histograms
+    u32 num_bins;
+    float lo;
+    float bin_scale;
+    float scale;
+    float offset;
+    float in_min, in_max, out_min, out_max;
+} stats_job;
+
+static void minmax_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    stats_job* job = ctx;
+    job->ranges[begin / STATS_GRAIN] = rs_span_minmax(job->data + begin, end - begin);
+}
+
+rs_range rs_grid_minmax(rs_grid* g) {
+    u32 n = num_chunks(g->size);
+    stats_job job = { .data = g->data, .size = g->size };
+    job.ranges = malloc((n > 0 ? n : 1) * sizeof(rs_range));
+    rs_pool_parallel_for(rs_default_pool(), g->size, STATS_GRAIN, minmax_chunks, &job);
+
+    rs_range r = { FLT_MAX, -FLT_MAX };
+    for (u32 i = 0; i < n; i++) {
+        if (job.ranges[i].min < r.min) r.min = job.ranges[i].min;
+        if (job.ranges[i].max > r.max) r.max = job.ranges[i].max;
+    }
+    free(job.ranges);
+    return r;
+}
+
+static void moment_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    stats_job* job = ctx;
+    job->partial[begin / STATS_GRAIN] = moments(job->data + begin, end - begin);
+}
+
+rs_stats rs_grid_stats(rs_grid* g) {
+    u32 n = num_chunks(g->size);
+    stats_job job = { .data = g->data, .size = g->size };
+    job.partial = malloc((n > 0 ? n : 1) * sizeof(span_moments));
+    rs_pool_parallel_for(rs_default_pool(), g->size, STATS_GRAIN, moment_chunks, &job);
+
+    // chunks are merged in order with the pairwise update of Chan et al.
+    rs_stats s = { FLT_MAX, -FLT_MAX, 0, 0, 0 };
+    double m2 = 0;
+    for (u32 i = 0; i < n; i++) {
+        span_moments* p = &job.partial[i];
+        if (p->range.min < s.min) s.min = p->range.min;
+        if (p->range.max > s.max) s.max = p->range.max;
+        if (p->count == 0) continue;
+        double total = (double)s.count + p->count;
+        double delta = p->mean - s.mean;
+        s.mean += delta * p->count / total;
+        m2 += p->m2 + delta * delta * ((double)s.count * p->count / total);
+        s.count += p->count;
+    }
+    s.variance = s.count > 0 ? m2 / s.count : 0;
+    free(job.partial);
+    return s;
+}
+
+static void histogram_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    stats_job* job = ctx;
+    u32* bins = &job->bins[(size_t)worker * job->num_bins];
+    float last = (float)(job->num_bins - 1);
+    for (u32 i = begin; i < end; i++) {
+        float v = job->data[i];
+        if (isnan(v)) continue;
+        float t = (v - job->lo) * job->bin_scale;
+        t = t > 0 ? t : 0;
+        t = t < last ? t : last;
+        bins[(u32)t]++;
+    }
+}
+
+void rs_grid_histogram(rs_grid* g, float lo, float hi, u32* bins, u32 num_bins) {
+    if (num_bins == 0) return;
+    rs_pool* pool = rs_default_pool();
+    u32 workers = rs_pool_size(pool);
+
+    stats_job job = { .data = g->data, .size = g->size, .num_bins = num_bins, .lo = lo };
+    job.bin_scale = hi > lo ? num_bins / (hi - lo) : 0;
+    job.bins = calloc((size_t)workers * num_bins, sizeof(u32));
+    rs_pool_parallel_for(pool, g->size, STATS_GRAIN, histogram_chunks, &job);
+
+    memset(bins, 0, num_bins * sizeof(u32));
+    for (u32 w = 0; w < workers; w++) {
+        for (u32 b = 0; b < num_bins; b++) {
+            bins[b] += job.bins[(size_t)w * num_bins + b];
+        }
+    }
+    free(job.bins);
+}
+
+static float percentile_from(u32* bins, u32 total, float lo, float width, float p) {
+    double target = (double)p * total;
+    double below = 0;
+    for (u32 b = 0; b < PERCENTILE_BINS; b++) {
+        if (below + bins[b] >= target && bins[b] > 0) {
+            // spread the cells of the bin evenly across it
+            double f = (target - below) / bins[b];
+            return lo + (b + (float)f) * width;
+        }
+        below += bins[b];
+    }
+    return lo + PERCENTILE_BINS * width;
+}
+
+rs_range rs_grid_percentiles(rs_grid* g, float p_lo, float p_hi) {
+    rs_range r = rs_grid_minmax(g);
+    if (!(r.max > r.min)) return r;
+
+    u32* bins = malloc(PERCENTILE_BINS * sizeof(u32));
+    rs_grid_histogram(g, r.min, r.max, bins, PERCENTILE_BINS);
+    u32 total = 0;
+    for (u32 b = 0; b < PERCENTILE_BINS; b++) {
+        total += bins[b];
+    }
+
+    float width = (r.max - r.min) / PERCENTILE_BINS;
+    rs_range p = {
+        percentile_from(bins, total, r.min, width, p_lo),
+        percentile_from(bins, total, r.min, width, p_hi),
+    };
+    free(bins);
+    return p;
+}
+
+//
+// transforms
+//
+
+static void affine_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    stats_job* job = ctx;
+    span_affine(job->data + begin, end - begin, job->scale, job->offset);
+}
+
+void rs_grid_affine(rs_grid* g, float scale, float offset) {
+    stats_job job = { .data = g->data, .size = g->size, .scale = scale, .offset = offset };
+    rs_pool_parallel_for(rs_default_pool(), g->size, STATS_GRAIN, affine_chunks, &job);
+}
+
+static void remap_chunks(void* ctx, u32 begin, u32 end, u32 worker) {
+    (void)worker;
+    stats_job* job = ctx;
+    rs_span_remap(job->data + begin, end - begin, job->in_min, job->in_max, job->out_min, job->out_max);
+}
+
+void rs_grid_remap(rs_grid* g, float in_min, float in_max, float out_min, float out_max) {
+    if (in_max == in_min) {
+        rs_grid_fill(g, out_min + (out_max - out_min) * 0.5f);
+        return;
+    }
+    stats_job job = { .data = g->data, .size = g->size,
+                      .in_min = in_min, .in_max = in_max, .out_min = out_min, .out_max = out_max };
+    rs_pool_parallel_for(rs_default_pool(), g->size, STATS_GRAIN, remap_chunks, &job);
+}
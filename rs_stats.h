@@ -0,0 +1,48 @@
+#ifndef RS_STATS_H
+#define RS_STATS_H
+
+#include "rs.h"
+
+//
+// reductions and bulk transforms over rs_grid. grid versions are split
+// over rs_default_pool() and vectorized with AVX2 when the cpu has it.
+// partial results are combined in a fixed order, so results don't depend
+// on the number of threads. NaN cells are skipped by the reductions.
+//
+
+typedef struct {
+    float min, max;
+} rs_range;
+
+typedef struct {
+    float min, max;
+    double mean;
+    double variance;          // population variance
+    u32 count;                // cells that aren't NaN
+} rs_stats;
+
+// span kernels, for callers that already walk a grid in tiles or rows
+rs_range rs_span_minmax(const float* v, u32 n);
+// v = rs_remap(v, in_min, in_max, out_min, out_max), same results
+void rs_span_remap(float* v, u32 n, float in_min, float in_max, float out_min, float out_max);
+// min/max of rs_range r and the span, for running bounds
+rs_range rs_range_merge(rs_range r, const float* v, u32 n);
+
+rs_range rs_grid_minmax(rs_grid* g);
+rs_stats rs_grid_stats(rs_grid* g);
+
+// counts cells into num_bins equal bins over [lo, hi], cells outside go to
+// the first or last bin
+void rs_grid_histogram(rs_grid* g, float lo, float hi, u32* bins, u32 num_bins);
+
+// approximate values below which p_lo and p_hi of the cells fall (0..1),
+// read off a fine histogram. useful to normalize without outliers
+rs_range rs_grid_percentiles(rs_grid* g, float p_lo, float p_hi);
+
+// in place v * scale + offset
+void rs_grid_affine(rs_grid* g, float scale, float offset);
+// in place rs_remap() of every cell in one pass. a flat input range maps
+// every cell to the middle of the output range
+void rs_grid_remap(rs_grid* g, float in_min, float in_max, float out_min, float out_max);
+
+#endif
@@ -0,0 +1,215 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "rs_world_file.h"
+#include "rs_rand.h"
+
+static u64 align_up(u64 n) {
+    return (n + RS_WORLD_ALIGN - 1) & ~(u64)(RS_WORLD_ALIGN - 1);
+}
+
+static u64 hash_float(u64 h, float f) {
+    u32 bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return rs_hash64(h ^ (bits + RS_RAND_GOLDEN));
+}
+
+static u64 hash_layer(u64 h, rs_layer_params* p) {
+    h = hash_float(h, p->scale);
+    h = hash_float(h, p->octaves);
+    h = hash_float(h, p->persistence);
+    h = hash_float(h, p->lacunarity);
+    h = hash_float(h, p->lo);
+    h = hash_float(h, p->hi);
+    h = rs_hash64(h ^ p->seed);
+    return rs_hash64(h ^ (p->engine + RS_RAND_GOLDEN));
+}
+
+u64 rs_world_params_hash(rs_world_params* params) {
+    u64 h = rs_hash64(RS_WORLD_VERSION);
+    h = hash_layer(h, &params->base);
+    h = hash_layer(h, &params->continentalness);
+    h = hash_layer(h, &params->erosion);
+    h = hash_float(h, params->map_lo);
+    return hash_float(h, params->map_hi);
+}
+
+// layer of t stored in blob b, NULL if t doesn't have it
+static rs_grid** blob_layer(rs_terra* t, int b) {
+    switch (b) {
+        case RS_WORLD_BLOB_MAP:             return &t->map;
+        case RS_WORLD_BLOB_BASE:            return &t->base;
+        case RS_WORLD_BLOB_CONTINENTALNESS: return &t->continentalness;
+        case RS_WORLD_BLOB_EROSION:         return &t->erosion;
+    }
+    return NULL;
+}
+
+static u32 blob_flag(int b) {
+    switch (b) {
+        case RS_WORLD_BLOB_BASE:            return RS_LAYER_BASE;
+        case RS_WORLD_BLOB_CONTINENTALNESS: return RS_LAYER_CONTINENTALNESS;
+        case RS_WORLD_BLOB_EROSION:         return RS_LAYER_EROSION;
+    }
+    return 0;
+}
+
+//
+// writing
+//
+
+static int write_padding(FILE* f, u64 from, u64 to) {
+    static const u8 zeros[RS_WORLD_ALIGN];
+    return to == from || fwrite(zeros, 1, to - from, f) == to - from;
+}
+
+int rs_save_world(const char* path, rs_terra* t, rs_world_params* params) {
+    rs_grid* map = t->map;
+    u64 blob_bytes = (u64)map->size * sizeof(float);
+
+    rs_world_header h;
+    memset(&h, 0, sizeof(h));
+    h.magic = RS_WORLD_MAGIC;
+    h.version = RS_WORLD_VERSION;
+    h.header_bytes = sizeof(rs_world_header);
+    h.width = map->width;
+    h.height = map->height;
+    h.params_hash = rs_world_params_hash(params);
+    h.params = *params;
+
+    u64 offset = align_up(sizeof(rs_world_header));
+    for (int b = 0; b < RS_WORLD_BLOBS; b++) {
+        rs_grid* g = *blob_layer(t, b);
+        if (g == NULL || g->width != map->width || g->height != map->height) continue;
+        h.layers |= blob_flag(b);
+        h.offsets[b] = offset;
+        offset = align_up(offset + blob_bytes);
+    }
+    h.file_bytes = offset;
+
+    size_t len = strlen(path);
+    char* tmp = malloc(len + 5);
+    memcpy(tmp, path, len);
+    memcpy(tmp + len, ".tmp", 5);
+
+    FILE* f = fopen(tmp, "wb");
+    if (f == NULL) {
+        free(tmp);
+        return 0;
+    }
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    u64 at = sizeof(h);
+    for (int b = 0; b < RS_WORLD_BLOBS && ok; b++) {
+        if (h.offsets[b] == 0) continue;
+        ok = write_padding(f, at, h.offsets[b])
+            && fwrite((*blob_layer(t, b))->data, sizeof(float), map->size, f) == map->size;
+        at = h.offsets[b] + blob_bytes;
+    }
+    ok = ok && write_padding(f, at, h.file_bytes);
+    ok = (fclose(f) == 0) && ok;
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok) remove(tmp);
+    free(tmp);
+    return ok;
+}
+
+//
+// loading
+//
+
+// field by field, rs_layer_params has padding that isn't necessarily zero
+static int layer_equal(rs_layer_params* a, rs_layer_params* b) {
+    return a->scale == b->scale && a->octaves == b->octaves
+        && a->persistence == b->persistence && a->lacunarity == b->lacunarity
+        && a->lo == b->lo && a->hi == b->hi
+        && a->seed == b->seed && a->engine == b->engine;
+}
+
+static int params_equal(rs_world_params* a, rs_world_params* b) {
+    return layer_equal(&a->base, &b->base)
+        && layer_equal(&a->continentalness, &b->continentalness)
+        && layer_equal(&a->erosion, &b->erosion)
+        && a->map_lo == b->map_lo && a->map_hi == b->map_hi;
+}
+
+static int header_matches(rs_world_header* h, u64 size, u32 width, u32 height, rs_world_params* params, u32 keep) {
+    if (h->magic != RS_WORLD_MAGIC) return 0;
+    if (h->version != RS_WORLD_VERSION) return 0;
+    if (h->header_bytes != sizeof(rs_world_header)) return 0;
+    if (h->file_bytes != size) return 0;
+    if (h->width != width || h->height != height) return 0;
+    if ((h->layers & keep) != keep) return 0;
+    if (h->params_hash != rs_world_params_hash(params)) return 0;
+    if (!params_equal(&h->params, params)) return 0;
+
+    u64 blob_bytes = (u64)width * height * sizeof(float);
+    for (int b = 0; b < RS_WORLD_BLOBS; b++) {
+        u64 at = h->offsets[b];
+        if (at == 0) {
+            // a layer the caller keeps has to be in the file, whatever
+            // h->layers claims
+            if (b == RS_WORLD_BLOB_MAP || (keep & blob_flag(b))) return 0;
+            continue;
+        }
+        if (at % RS_WORLD_ALIGN != 0 || at < sizeof(rs_world_header)) return 0;
+        if (at > size || size - at < blob_bytes) return 0;
+    }
+    return 1;
+}
+
+void rs_unmap_world(void* mapping, size_t bytes) {
+    munmap(mapping, bytes);
+}
+
+rs_terra* rs_load_world(const char* path, u32 width, u32 height, rs_world_params* params, u32 keep) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (u64)st.st_size < sizeof(rs_world_header)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    // private pages, so a loaded world can be edited like a generated one
+    void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return NULL;
+
+    rs_world_header* h = mapping;
+    if (!header_matches(h, size, width, height, params, keep)) {
+        munmap(mapping, size);
+        return NULL;
+    }
+    posix_madvise(mapping, size, POSIX_MADV_WILLNEED);
+
+    rs_terra* t = calloc(1, sizeof(rs_terra));
+    t->mapping = mapping;
+    t->mapping_bytes = size;
+    for (int b = 0; b < RS_WORLD_BLOBS; b++) {
+        if (b != RS_WORLD_BLOB_MAP && !(keep & blob_flag(b))) continue;
+        rs_grid* g = malloc(sizeof(rs_grid));
+        g->width = width;
+        g->height = height;
+        g->size = width * height;
+        g->data = (float*)((u8*)mapping + h->offsets[b]);
+        *blob_layer(t, b) = g;
+    }
+    return t;
+}
+
+rs_terra* rs_cached_world(const char* path, u32 width, u32 height, rs_world_params* params, u32 keep) {
+    rs_terra* t = rs_load_world(path, width, height, params, keep);
+    if (t != NULL) return t;
+
+    t = rs_build_world_layers(width, height, params, keep);
+    if (!rs_save_world(path, t, params)) {
+        fprintf(stderr, "rs: couldn't write world cache %s\n", path);
+    }
+    return t;
+}
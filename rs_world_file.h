@@ -0,0 +1,58 @@
+#ifndef RS_WORLD_FILE_H
+#define RS_WORLD_FILE_H
+
+#include <stddef.h>
+#include "rs.h"
+
+//
+// binary world files. a fixed header with the generation parameters and
+// their hash is followed by the layers as raw native-endian floats, each
+// starting on a RS_WORLD_ALIGN byte boundary. loading maps the file
+// privately and points the rs_grid data straight at the layers, so
+// nothing is parsed or copied, and writes to a loaded world stay in
+// memory. a file is only used when its parameters, size and layers match
+// the request, otherwise the world is generated again.
+//
+
+#define RS_WORLD_MAGIC   (0x444c524f57535223ull)   // "#RSWORLD" in little-endian files
+#define RS_WORLD_VERSION (2)
+#define RS_WORLD_ALIGN   (64)
+
+// blobs in file order
+enum {
+    RS_WORLD_BLOB_MAP,
+    RS_WORLD_BLOB_BASE,
+    RS_WORLD_BLOB_CONTINENTALNESS,
+    RS_WORLD_BLOB_EROSION,
+    RS_WORLD_BLOBS,
+};
+
+typedef struct {
+    u64 magic;
+    u32 version;
+    u32 header_bytes;         // sizeof(rs_world_header) of the writer
+    u32 width;
+    u32 height;
+    u32 layers;               // RS_LAYER_* flags of the stored layers
+    u32 reserved;
+    u64 params_hash;
+    u64 file_bytes;
+    u64 offsets[RS_WORLD_BLOBS];   // 0 when the layer isn't stored
+    rs_world_params params;
+} rs_world_header;
+
+u64 rs_world_params_hash(rs_world_params* params);
+
+// writes the map and the kept layers of t, through a temporary file that
+// replaces path when complete. returns 0 when the file couldn't be written
+int rs_save_world(const char* path, rs_terra* t, rs_world_params* params);
+// maps a world file generated with params at width x height that stores
+// every layer in keep (RS_LAYER_* flags), NULL if there isn't one
+rs_terra* rs_load_world(const char* path, u32 width, u32 height, rs_world_params* params, u32 keep);
+// the file at path if it matches, otherwise a new world saved to path
+rs_terra* rs_cached_world(const char* path, u32 width, u32 height, rs_world_params* params, u32 keep);
+
+// called by rs_free_terra() for mapped worlds
+void rs_unmap_world(void* mapping, size_t bytes);
+
+#endif